@@ -0,0 +1,166 @@
+#pragma once
+
+#include "robot.hpp"
+#include "parallel.hpp"
+
+#include <chrono>
+
+/**
+ * @brief One simulation in a batch: a start pose on one of the batch's maps.
+ */
+struct Job
+{
+        size_t map;  // index into the maps passed to simulate_batch
+        Pose   pose; // start pose
+};
+
+/**
+ * @brief Outcome of one Job. A job cut short by the limits is not resumable: its visited state is dropped with the
+ * robot, so the pose only says where it was stopped, and running the job again starts over from its start pose.
+ */
+struct JobResult
+{
+        size_t                   cleaned;     // as returned by Robot::run, or so far if the job was cut short
+        std::chrono::nanoseconds elapsed;     // wall time of the run, including resetting the visited state
+        Termination              termination; // see finished()
+        BasicPose<TableRepr>     pose;        // where the robot stopped or was cut short
+};
+
+/**
+ * @brief Runs every job's Robot::run on a work-stealing thread pool.
+ *
+ * The maps are only read: each job runs against the map's shared MapGeometry with a CoverageState of its own, so memory
+ * grows with the no. of threads times one bit per cell rather than with copies of the layout.
+ * @tparam Repr Representation the robots run with; TableRepr by default.
+ * @param limits Applied to every job: max_steps caps each job's steps, while the deadline and the cancellation flag stop
+ * whatever is still running (and every job not yet started, which then reports 1 cell cleaned, its start).
+ * @return one result per job, in job order.
+ */
+template <class Repr = TableRepr>
+auto simulate_batch(const std::vector<Map>& maps, const std::vector<Job>& jobs, const unsigned nthreads = default_threads(),
+                    const RunLimits& limits = RunLimits{}) -> std::vector<JobResult>
+{
+        using Clock = std::chrono::steady_clock;
+
+        std::vector<JobResult> results(jobs.size());
+        parallel_for(jobs.size(), [&](const size_t i, unsigned) {
+                const auto& job = jobs[i];
+                const auto  t0  = Clock::now();
+
+                const auto&   geometry = maps[job.map].geometry();
+                CoverageState coverage{geometry};
+                BasicRobot<Repr> robot{geometry, coverage, pose_cast<Repr>(job.pose), false};
+                const auto result = robot.run(limits);
+                results[i].cleaned     = result.cleaned;
+                results[i].termination = result.termination;
+                results[i].pose        = result.pose;
+                results[i].elapsed     = Clock::now() - t0;
+        }, nthreads);
+        return results;
+}
+
+/**
+ * @brief Runs Robot::run from every start pose on one geometry, advancing `width` robots round-robin so that their
+ * cache misses overlap.
+ *
+ * On a map much larger than the cache nearly every step is a dependent miss into the plane or the visited bitset. Here
+ * each robot takes one step and then prefetches the words holding the cell ahead of it before the other robots take
+ * theirs, so by the time it is serviced again the cell is (ideally) in cache: AMAC-style interleaving. A robot that
+ * stops hands its lane, and its coverage, to the next start pose; the coverage is reset by undoing the robot's visits
+ * rather than by clearing the whole bitset. Runs the same steps as BasicRobot<TableRepr>::run().
+ * @param width Robots advanced together; at least 1.
+ * @return no. of cells cleaned from each start pose, in order.
+ */
+inline auto run_interleaved(const MapGeometry& geometry, const std::vector<Pose>& starts, const size_t width = 8)
+        -> std::vector<size_t>
+{
+        struct Lane
+        {
+                size_t              job;
+                size_t              i;      // plane index of p
+                Position            p;
+                Heading             h;
+                bool                just_visited;
+                int                 nblocked;
+                size_t              ncleaned;
+                CoverageState       coverage;
+                std::vector<size_t> marked; // cells to unmark when the lane is handed on
+        };
+
+        const ptrdiff_t stride = geometry.row_stride();
+        const ptrdiff_t delta[DirectionCount] = {1, stride, -1, -stride};
+
+        const auto prefetch = [&](const Lane& lane) {
+                const auto next = static_cast<size_t>(static_cast<ptrdiff_t>(lane.i) + delta[static_cast<size_t>(lane.h)]);
+                __builtin_prefetch(geometry.data() + next / MapGeometry::CellsPerWord);
+                __builtin_prefetch(lane.coverage.data() + next / CoverageState::BitsPerWord);
+        };
+
+        size_t next_job = 0;
+        const auto start = [&](Lane& lane) {
+                const auto pose = pose_cast<TableRepr>(starts[next_job]);
+                lane.job = next_job++;
+                lane.i = geometry.index(pose.p);
+                lane.p = pose.p;
+                lane.h = pose.d;
+                lane.just_visited = false;
+                lane.nblocked = 0;
+                lane.ncleaned = 1;
+                lane.coverage.mark(lane.i, lane.p);
+                lane.marked.push_back(lane.i);
+                prefetch(lane);
+        };
+
+        std::vector<size_t> cleaned(starts.size());
+        std::vector<Lane>   lanes;
+        const auto nlanes = std::min(std::max<size_t>(width, 1), starts.size());
+        lanes.reserve(nlanes);
+        while (lanes.size() < nlanes) {
+                lanes.push_back(Lane{0, 0, {}, Heading::R, false, 0, 0, CoverageState{geometry}, {}});
+                start(lanes.back());
+        }
+
+        for (auto active = lanes.size(); active > 0;) {
+                for (size_t l = 0; l < active;) {
+                        auto& lane = lanes[l];
+                        const auto next = static_cast<size_t>(static_cast<ptrdiff_t>(lane.i) + delta[static_cast<size_t>(lane.h)]);
+                        auto stopped = false;
+                        switch (lane.coverage.test(next) ? CellState::Visited : geometry.get(next)) {
+                                case CellState::Empty:
+                                        lane.just_visited = false;
+                                        lane.nblocked = 0;
+                                        lane.i = next;
+                                        lane.p = lane.p + lane.h;
+                                        lane.coverage.mark(next, lane.p);
+                                        lane.marked.push_back(next);
+                                        lane.ncleaned += 1;
+                                        break;
+                                case CellState::Visited:
+                                        stopped = lane.just_visited;
+                                        lane.just_visited = true;
+                                        lane.nblocked = 0;
+                                        lane.i = next;
+                                        lane.p = lane.p + lane.h;
+                                        break;
+                                default:
+                                        lane.h = rotated(lane.h);
+                                        stopped = ++lane.nblocked == static_cast<int>(DirectionCount);
+                        }
+
+                        if (!stopped) {
+                                prefetch(lane);
+                                l += 1;
+                                continue;
+                        }
+                        cleaned[lane.job] = lane.ncleaned;
+                        for (const auto i: lane.marked) { lane.coverage.unmark(i); }
+                        lane.marked.clear();
+                        if (next_job < starts.size()) {
+                                start(lane);
+                                l += 1;
+                        }
+                        else { std::swap(lane, lanes[--active]); }
+                }
+        }
+        return cleaned;
+}
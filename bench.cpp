@@ -0,0 +1,605 @@
+#include "robot.hpp"
+#include "batch.hpp"
+#include "simd.hpp"
+#include "sweep.hpp"
+#include "incremental.hpp"
+#include "whatif.hpp"
+#include "fleet.hpp"
+#include "lockstep.hpp"
+#include "map_file.hpp"
+#include "layouts.hpp"
+#include "benchmark.hpp"
+
+#include <filesystem>
+#include <optional>
+
+namespace
+{
+        constexpr int Sizes[]     = {64, 256, 1024, 4096};
+        constexpr int Densities[] = {0, 5, 20};
+
+        /**
+         * @brief Counts the iterations of the peek/move_to loop a run takes, rotations included.
+         */
+        auto count_steps(const MapGeometry& geometry, const BasicPose<TableRepr> start) -> size_t
+        {
+                using Robot = BasicRobot<TableRepr>;
+
+                CoverageState coverage{geometry};
+                Robot         robot{geometry, coverage, start};
+                auto          pose = start;
+                for (size_t nsteps = 1;; ++nsteps) {
+                        const auto state = robot.move_to(robot.peek(pose), pose);
+                        if (std::holds_alternative<Robot::Stopped>(state)) { return nsteps; }
+                        pose = std::get<Robot::Running>(state).pose;
+                }
+        }
+
+        /**
+         * @brief A complete Robot::run from the origin, heading right, including setting up the robot and its coverage.
+         */
+        template <class Repr>
+        auto run(bench::State& state, const layouts::Family family, const int n, const int density) -> void
+        {
+                const MapGeometry geometry{layouts::make(family, n, density)};
+                const BasicPose<Repr> start{Position{0, 0}, typename Repr::Direction{}};
+                const auto nsteps = count_steps(geometry, pose_cast<TableRepr>(start));
+
+                size_t cleaned{};
+                for (auto _: state) {
+                        CoverageState    coverage{geometry};
+                        BasicRobot<Repr> robot{geometry, coverage, start, false};
+                        cleaned = robot.run();
+                }
+                const auto iterations = static_cast<double>(state.count());
+                state.counter("steps", static_cast<double>(nsteps));
+                state.counter("ns/step", state.elapsed() * 1e9 / (static_cast<double>(nsteps) * iterations));
+                state.counter("cleaned", static_cast<double>(cleaned) * iterations, bench::Counter::Rate);
+                state.counter("allocs", state.allocations_per_iteration());
+        }
+
+        /**
+         * @brief The same run through run(RunLimits), which also reports the termination and checks for cycles; with
+         * polled, it also has a deadline and a cancellation flag to poll (neither of which ends the run).
+         */
+        auto run_checked(bench::State& state, const layouts::Family family, const int n, const int density,
+                         const bool polled = false) -> void
+        {
+                const MapGeometry geometry{layouts::make(family, n, density)};
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+                const auto nsteps = count_steps(geometry, start);
+
+                const std::atomic<bool> cancel{false};
+                RunLimits limits;
+                if (polled) {
+                        limits.deadline = RunLimits::Clock::now() + std::chrono::hours{1};
+                        limits.cancel   = &cancel;
+                }
+                RunResult result{};
+                for (auto _: state) {
+                        CoverageState         coverage{geometry};
+                        BasicRobot<TableRepr> robot{geometry, coverage, start, false};
+                        result = robot.run(limits);
+                }
+                const auto iterations = static_cast<double>(state.count());
+                state.counter("steps", static_cast<double>(nsteps));
+                state.counter("ns/step", state.elapsed() * 1e9 / (static_cast<double>(nsteps) * iterations));
+                state.counter("cleaned", static_cast<double>(result.cleaned) * iterations, bench::Counter::Rate);
+                state.counter("allocs", state.allocations_per_iteration());
+                state.counter(name(result.termination), 1);
+        }
+
+        /**
+         * @brief Latency of step(n) as a control loop would call it: every call is timed on its own and the percentiles
+         * of the per-call times are reported (they include one clock read, roughly 20 ns). A robot that stops is
+         * restarted on the same coverage, cleared, between two calls.
+         */
+        auto step_latency(bench::State& state, const int n, const size_t per_tick) -> void
+        {
+                using Clock = std::chrono::steady_clock;
+
+                const MapGeometry geometry{layouts::spiral(n, n)};
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+
+                CoverageState coverage{geometry};
+                std::optional<BasicRobot<TableRepr>> robot;
+                robot.emplace(geometry, coverage, start, false);
+                std::vector<std::uint32_t> samples;
+                samples.reserve(state.count());
+
+                for (auto _: state) {
+                        const auto t0 = Clock::now();
+                        const auto stepped = robot->step(per_tick);
+                        const auto t1 = Clock::now();
+                        samples.push_back(static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+                        if (std::holds_alternative<BasicRobot<TableRepr>::Stopped>(stepped.state)) {
+                                coverage.clear();
+                                robot.emplace(geometry, coverage, start, false);
+                        }
+                }
+                std::sort(samples.begin(), samples.end());
+                const auto percentile = [&samples](const double q) {
+                        return static_cast<double>(samples[std::min(samples.size() - 1, static_cast<size_t>(q * static_cast<double>(samples.size())))]);
+                };
+                state.counter("p50_ns", percentile(0.5));
+                state.counter("p99_ns", percentile(0.99));
+                state.counter("p99.9_ns", percentile(0.999));
+                state.counter("max_ns", static_cast<double>(samples.back()));
+                state.counter("allocs", state.allocations_per_iteration());
+        }
+
+        /**
+         * @brief The same run walking a prebuilt TransitionTable; building the table is not part of the measured loop.
+         */
+        auto run_transitions(bench::State& state, const layouts::Family family, const int n, const int density) -> void
+        {
+                const MapGeometry     geometry{layouts::make(family, n, density)};
+                const TransitionTable table{geometry};
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+                const auto nsteps = count_steps(geometry, start);
+
+                size_t cleaned{};
+                for (auto _: state) {
+                        CoverageState         coverage{geometry};
+                        BasicRobot<TableRepr> robot{geometry, coverage, start, false};
+                        cleaned = robot.run(table);
+                }
+                const auto iterations = static_cast<double>(state.count());
+                state.counter("steps", static_cast<double>(nsteps));
+                state.counter("ns/step", state.elapsed() * 1e9 / (static_cast<double>(nsteps) * iterations));
+                state.counter("cleaned", static_cast<double>(cleaned) * iterations, bench::Counter::Rate);
+                state.counter("allocs", state.allocations_per_iteration());
+        }
+
+        /**
+         * @brief The same run with the jump engine, which enters each straight stretch of empty cells in one step.
+         * @tparam Obstacles ObstaclePlanes, DistanceTable or LiftingTable, built outside the measured loop.
+         */
+        template <class Obstacles>
+        auto run_jump(bench::State& state, const layouts::Family family, const int n, const int density) -> void
+        {
+                const MapGeometry geometry{layouts::make(family, n, density)};
+                const Obstacles   planes{geometry};
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+                const auto nsteps = count_steps(geometry, start);
+
+                size_t cleaned{};
+                for (auto _: state) {
+                        CoverageState         coverage{geometry};
+                        BasicRobot<TableRepr> robot{geometry, coverage, start, false};
+                        cleaned = robot.run(planes);
+                }
+                const auto iterations = static_cast<double>(state.count());
+                state.counter("steps", static_cast<double>(nsteps));
+                state.counter("ns/step", state.elapsed() * 1e9 / (static_cast<double>(nsteps) * iterations));
+                state.counter("cleaned", static_cast<double>(cleaned) * iterations, bench::Counter::Rate);
+                state.counter("allocs", state.allocations_per_iteration());
+        }
+
+        /**
+         * @brief Building one of the precomputed tables, with the memory it takes per map cell.
+         */
+        template <class Table>
+        auto build(bench::State& state, const int n) -> void
+        {
+                const MapGeometry geometry{layouts::make(layouts::Family::Corridors, n, 5)};
+
+                size_t bytes{};
+                for (auto _: state) {
+                        const Table table{geometry};
+                        bytes = table.bytes();
+                }
+                const auto cells = static_cast<double>(n) * n;
+                state.counter("cells", cells * static_cast<double>(state.count()), bench::Counter::Rate);
+                state.counter("bytes/cell", static_cast<double>(bytes) / cells);
+        }
+
+        /**
+         * @brief A run that records its full pose trace into an arena. The arena keeps its first buffer across runs, so
+         * only a trace that outgrows every earlier one allocates.
+         */
+        auto run_traced(bench::State& state, const int n) -> void
+        {
+                const MapGeometry geometry{layouts::spiral(n, n)};
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+
+                std::vector<std::byte> buffer(size_t{1} << 16);
+                std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size()};
+                size_t cleaned{};
+                for (auto _: state) {
+                        {
+                                CoverageState         coverage{geometry};
+                                BasicRobot<TableRepr> robot{geometry, coverage, start, true, &arena};
+                                cleaned = robot.run();
+                        }
+                        arena.release();
+                }
+                state.counter("cleaned", static_cast<double>(cleaned * state.count()), bench::Counter::Rate);
+                state.counter("allocs", state.allocations_per_iteration());
+        }
+
+        /**
+         * @brief A fleet of robots started on random free cells of an open map with 5% obstacles.
+         * @param simulate simulate_fleet or simulate_lockstep.
+         */
+        template <class Simulate>
+        auto run_fleet(bench::State& state, Simulate simulate, const size_t nrobots, const int n, const unsigned nthreads)
+                -> void
+        {
+                const MapGeometry geometry{layouts::make(layouts::Family::Open, n, 5)};
+                std::mt19937 rng{7};
+                std::vector<Pose> starts;
+                std::vector<bool> taken(geometry.size());
+                while (starts.size() < nrobots) {
+                        const Position p{static_cast<int>(rng() % static_cast<unsigned>(n)), static_cast<int>(rng() % static_cast<unsigned>(n))};
+                        const auto i = geometry.index(p);
+                        if (geometry.get(i) == CellState::Blocked || taken[i]) { continue; }
+                        taken[i] = true;
+                        starts.push_back(Pose{p, to_direction(static_cast<Heading>(rng() % DirectionCount))});
+                }
+
+                FleetResult result{};
+                for (auto _: state) { result = simulate(geometry, starts, nthreads); }
+                const auto iterations = static_cast<double>(state.count());
+                state.counter("ticks", static_cast<double>(result.ticks));
+                state.counter("ns/robot-tick", state.elapsed() * 1e9 / (static_cast<double>(result.ticks * nrobots) * iterations));
+                state.counter("cleaned", static_cast<double>(result.total) * iterations, bench::Counter::Rate);
+        }
+
+        /**
+         * @brief Start poses on random free cells, the sweep workload.
+         */
+        auto sweep_starts(const MapGeometry& geometry, const size_t count) -> std::vector<Pose>
+        {
+                const auto[w, h] = geometry.shape();
+                std::mt19937 rng{11};
+                std::vector<Pose> starts;
+                while (starts.size() < count) {
+                        const Position p{static_cast<int>(rng() % static_cast<unsigned>(w)), static_cast<int>(rng() % static_cast<unsigned>(h))};
+                        if (geometry.state(p) == CellState::Blocked) { continue; }
+                        starts.push_back(Pose{p, to_direction(static_cast<Heading>(rng() % DirectionCount))});
+                }
+                return starts;
+        }
+
+        auto sweep_steps(const MapGeometry& geometry, const std::vector<Pose>& starts) -> double
+        {
+                size_t nsteps{};
+                for (const auto& start: starts) { nsteps += count_steps(geometry, pose_cast<TableRepr>(start)); }
+                return static_cast<double>(nsteps);
+        }
+
+        /**
+         * @brief The sweep with the single-robot loop, one run after another. The coverage is reused and each run undone
+         * through its trace, the same reset the interleaved engine uses.
+         */
+        auto sweep_single(bench::State& state, const int n, const size_t count) -> void
+        {
+                const MapGeometry geometry{layouts::make(layouts::Family::Corridors, n, 0)};
+                const auto starts = sweep_starts(geometry, count);
+                const auto nsteps = sweep_steps(geometry, starts);
+
+                CoverageState coverage{geometry};
+                std::vector<std::byte> buffer(size_t{1} << 20);
+                std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size()};
+                for (auto _: state) {
+                        for (const auto& start: starts) {
+                                {
+                                        BasicRobot<TableRepr> robot{geometry, coverage, pose_cast<TableRepr>(start), true, &arena};
+                                        robot.run();
+                                        for (const auto& pose: robot.trace()) { coverage.unmark(geometry.index(pose.p)); }
+                                }
+                                arena.release();
+                        }
+                }
+                state.counter("steps", nsteps * static_cast<double>(state.count()), bench::Counter::Rate);
+        }
+
+        /**
+         * @brief The sweep with run_interleaved at the given batch width.
+         */
+        auto sweep_interleaved(bench::State& state, const int n, const size_t count, const size_t width) -> void
+        {
+                const MapGeometry geometry{layouts::make(layouts::Family::Corridors, n, 0)};
+                const auto starts = sweep_starts(geometry, count);
+                const auto nsteps = sweep_steps(geometry, starts);
+
+                for (auto _: state) { run_interleaved(geometry, starts, width); }
+                state.counter("steps", nsteps * static_cast<double>(state.count()), bench::Counter::Rate);
+        }
+
+        /**
+         * @brief The sweep with run_lanes and the given kernel.
+         */
+        auto sweep_lanes(bench::State& state, const int n, const size_t count, const lanes::Isa isa) -> void
+        {
+                const MapGeometry geometry{layouts::make(layouts::Family::Corridors, n, 0)};
+                const auto starts = sweep_starts(geometry, count);
+                const auto nsteps = sweep_steps(geometry, starts);
+
+                for (auto _: state) { run_lanes(geometry, starts, isa); }
+                state.counter("steps", nsteps * static_cast<double>(state.count()), bench::Counter::Rate);
+        }
+
+        /**
+         * @brief Every start pose of a corridors map with sweep_all, the distance table built once outside the loop.
+         */
+        auto sweep_every(bench::State& state, const int n, const unsigned nthreads) -> void
+        {
+                const MapGeometry   geometry{layouts::make(layouts::Family::Corridors, n, 10)};
+                const DistanceTable distances{geometry};
+
+                const auto[w, h] = geometry.shape();
+                size_t nstarts = 0;
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) { nstarts += geometry.state(Position{x, y}) != CellState::Blocked ? DirectionCount : 0; }
+                }
+
+                for (auto _: state) { sweep_all(geometry, distances, nthreads); }
+                state.counter("starts", static_cast<double>(nstarts * state.count()), bench::Counter::Rate);
+        }
+
+        /**
+         * @brief Short runs from many start poses on one large, densely blocked map, resetting the visited state between
+         * runs by constructing a fresh one (fresh), clearing it (Coverage::clear) or, for EpochCoverage, bumping the epoch.
+         */
+        template <class Coverage>
+        auto short_runs(bench::State& state, const int n, const bool fresh) -> void
+        {
+                const MapGeometry geometry{layouts::make(layouts::Family::Open, n, 40)};
+                const auto starts = sweep_starts(geometry, 256);
+
+                Coverage coverage{geometry};
+                size_t cleaned{};
+                for (auto _: state) {
+                        for (const auto& start: starts) {
+                                if (fresh) {
+                                        Coverage own{geometry};
+                                        cleaned += BasicRobot<TableRepr, Coverage>{geometry, own, pose_cast<TableRepr>(start), false}.run();
+                                }
+                                else {
+                                        coverage.clear();
+                                        cleaned += BasicRobot<TableRepr, Coverage>{geometry, coverage, pose_cast<TableRepr>(start), false}.run();
+                                }
+                        }
+                }
+                state.counter("runs", static_cast<double>(starts.size() * state.count()), bench::Counter::Rate);
+                state.counter("cleaned/run", static_cast<double>(cleaned) / static_cast<double>(starts.size() * state.count()));
+        }
+
+        /**
+         * @brief Single-cell edits to a large map, each toggling a random cell on the robot's path (and the next one
+         * toggling it back): resumed by IncrementalRun, or with full, a fresh run on the edited map.
+         */
+        auto edits(bench::State& state, const layouts::Family family, const int n, const bool full) -> void
+        {
+                const MapGeometry geometry{layouts::make(family, n, 0)};
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+
+                CoverageState traced{geometry, true};
+                BasicRobot<TableRepr>{geometry, traced, start, false}.run();
+                std::vector<Position> cells;
+                std::mt19937 rng{5};
+                for (size_t k = 0; k < 64; ++k) { cells.push_back(traced.trace()[1 + rng() % (traced.trace().size() - 1)]); }
+
+                IncrementalRun run{geometry, start};
+                const auto nsteps = static_cast<double>(run.steps());
+
+                // The full runs edit a copy of the plane in place, the same way IncrementalRun does.
+                std::vector<MapGeometry::Word> plane(geometry.data(), geometry.data() + MapGeometry::words(n, n));
+                const MapGeometry edited{n, n, plane.data(), nullptr};
+
+                size_t k{}, replayed{};
+                for (auto _: state) {
+                        const auto p = cells[k++ / 2 % cells.size()];
+                        if (full) {
+                                const auto i = edited.index(p);
+                                plane[i / MapGeometry::CellsPerWord] ^= MapGeometry::Word{2} << (i % MapGeometry::CellsPerWord * 2);
+                                CoverageState         coverage{edited};
+                                BasicRobot<TableRepr> robot{edited, coverage, start, false};
+                                robot.run();
+                        }
+                        else {
+                                run.toggle(p);
+                                replayed += run.replayed();
+                        }
+                }
+                state.counter("steps", nsteps);
+                if (!full) { state.counter("replayed", static_cast<double>(replayed) / static_cast<double>(state.count())); }
+        }
+
+        /**
+         * @brief What-if analysis over every obstacle of a map, or with naive, one full run per obstacle on an edited copy
+         * of the plane.
+         */
+        auto obstacles_what_if(bench::State& state, const layouts::Family family, const int n, const bool naive,
+                               const unsigned nthreads) -> void
+        {
+                const MapGeometry geometry{layouts::make(family, n, 0)};
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+
+                size_t nobstacles{};
+                for (int y = 0; y < n; ++y) {
+                        for (int x = 0; x < n; ++x) { nobstacles += geometry.state(Position{x, y}) == CellState::Blocked; }
+                }
+
+                std::vector<MapGeometry::Word> plane(geometry.data(), geometry.data() + MapGeometry::words(n, n));
+                const MapGeometry edited{n, n, plane.data(), nullptr};
+                for (auto _: state) {
+                        if (!naive) {
+                                what_if(geometry, start, nthreads);
+                                continue;
+                        }
+                        for (int y = 0; y < n; ++y) {
+                                for (int x = 0; x < n; ++x) {
+                                        const auto i = edited.index(Position{x, y});
+                                        if (edited.get(i) != CellState::Blocked) { continue; }
+                                        const auto bit = MapGeometry::Word{2} << (i % MapGeometry::CellsPerWord * 2);
+                                        plane[i / MapGeometry::CellsPerWord] ^= bit;
+                                        CoverageState coverage{edited};
+                                        BasicRobot<TableRepr>{edited, coverage, start, false}.run();
+                                        plane[i / MapGeometry::CellsPerWord] ^= bit;
+                                }
+                        }
+                }
+                state.counter("obstacles", static_cast<double>(nobstacles));
+        }
+
+        auto map_text(const int n) -> std::string
+        {
+                std::string text;
+                for (const auto& row: layouts::spiral(n, n)) { text.append(row).push_back('\n'); }
+                return text;
+        }
+
+        /**
+         * @brief The streaming text parser, fed in 1 MiB chunks.
+         */
+        auto parse_stream(bench::State& state, const int n) -> void
+        {
+                const auto text = map_text(n);
+                for (auto _: state) {
+                        TextMapParser parser;
+                        for (size_t i = 0; i < text.size(); i += 1 << 20) {
+                                parser.feed(text.data() + i, std::min<size_t>(1 << 20, text.size() - i));
+                        }
+                        parser.finish();
+                }
+                state.counter("bytes", static_cast<double>(text.size() * state.count()), bench::Counter::Rate);
+        }
+
+        /**
+         * @brief Splitting the same text into a Layout and converting that.
+         */
+        auto parse_layout(bench::State& state, const int n) -> void
+        {
+                const auto text = map_text(n);
+                for (auto _: state) {
+                        MapGeometry::Layout layout;
+                        for (size_t i = 0, j; i < text.size(); i = j + 1) {
+                                j = text.find('\n', i);
+                                layout.emplace_back(text, i, j - i);
+                        }
+                        const MapGeometry geometry{layout};
+                }
+                state.counter("bytes", static_cast<double>(text.size() * state.count()), bench::Counter::Rate);
+        }
+
+        /**
+         * @brief Opening a binary map file and touching every page of it, which is what a run over the whole map ends
+         * up paying for.
+         */
+        auto open_file(bench::State& state, const int n) -> void
+        {
+                const auto path = (std::filesystem::temp_directory_path() / "robot_cleaner_bench.rcm").string();
+                save_map(MapGeometry{layouts::spiral(n, n)}, path);
+
+                MapGeometry::Word sum{};
+                for (auto _: state) {
+                        const auto geometry = open_map(path);
+                        const auto words    = MapGeometry::words(n, n);
+                        for (size_t i = 0; i < words; i += 4096 / sizeof(MapGeometry::Word)) { sum += geometry->data()[i]; }
+                }
+                state.counter("checksum", static_cast<double>(sum & 0xFFFF)); // keeps the page reads from being optimised away
+                std::filesystem::remove(path);
+        }
+}
+
+auto main(int argc, char** argv) -> int
+{
+        for (const auto family: layouts::Families) {
+                for (const auto n: Sizes) {
+                        for (const auto density: Densities) {
+                                const auto args = std::string{layouts::name(family)} + "/" + std::to_string(n) + "/"
+                                                  + std::to_string(density);
+                                bench::add("run<variant>/" + args, [=](auto& s) { run<VariantRepr>(s, family, n, density); });
+                                bench::add("run<table>/" + args, [=](auto& s) { run<TableRepr>(s, family, n, density); });
+                                bench::add("run<table,checked>/" + args, [=](auto& s) { run_checked(s, family, n, density); });
+                                bench::add("run<table,transitions>/" + args,
+                                           [=](auto& s) { run_transitions(s, family, n, density); });
+                                bench::add("run<table,jump>/" + args,
+                                           [=](auto& s) { run_jump<ObstaclePlanes>(s, family, n, density); });
+                                bench::add("run<table,distances>/" + args,
+                                           [=](auto& s) { run_jump<DistanceTable>(s, family, n, density); });
+                                if (n <= 1024) { // the lifting tables grow with the obstacles times the levels
+                                        bench::add("run<table,lifting>/" + args,
+                                                   [=](auto& s) { run_jump<LiftingTable>(s, family, n, density); });
+                                }
+                        }
+                }
+        }
+        for (const auto n: Sizes) {
+                bench::add("run<table,trace>/spiral/" + std::to_string(n), [=](auto& s) { run_traced(s, n); });
+                bench::add("run<table,polled>/spiral/" + std::to_string(n) + "/0",
+                           [=](auto& s) { run_checked(s, layouts::Family::Spiral, n, 0, true); });
+                for (const size_t per_tick: {1, 64}) {
+                        bench::add("step<latency>/spiral/" + std::to_string(n) + "/steps:" + std::to_string(per_tick),
+                                   [=](auto& s) { step_latency(s, n, per_tick); });
+                }
+                bench::add("transitions/build/" + std::to_string(n), [=](auto& s) { build<TransitionTable>(s, n); });
+                bench::add("obstacles/build/" + std::to_string(n), [=](auto& s) { build<ObstaclePlanes>(s, n); });
+                bench::add("distances/build/" + std::to_string(n), [=](auto& s) { build<DistanceTable>(s, n); });
+                if (n <= 1024) { bench::add("lifting/build/" + std::to_string(n), [=](auto& s) { build<LiftingTable>(s, n); }); }
+        }
+        for (const auto n: {1024, 4096}) {
+                const auto args = std::to_string(n) + "/starts:512";
+                bench::add("sweep<single>/" + args, [=](auto& s) { sweep_single(s, n, 512); });
+                for (const size_t width: {1, 2, 4, 8, 16, 32, 64}) {
+                        bench::add("sweep<interleaved>/" + args + "/width:" + std::to_string(width),
+                                   [=](auto& s) { sweep_interleaved(s, n, 512, width); });
+                }
+                for (const auto isa: {lanes::Isa::Scalar, lanes::Isa::Avx2, lanes::Isa::Avx512}) {
+                        if (isa > lanes::detect()) { break; }
+                        bench::add("sweep<lanes>/" + args + "/" + lanes::name(isa), [=](auto& s) { sweep_lanes(s, n, 512, isa); });
+                }
+        }
+        for (const auto family: {layouts::Family::Corridors, layouts::Family::Spiral}) {
+                for (const auto n: {1024, 4096}) {
+                        const auto args = std::string{layouts::name(family)} + "/" + std::to_string(n);
+                        bench::add("edit<full>/" + args, [=](auto& s) { edits(s, family, n, true); });
+                        bench::add("edit<incremental>/" + args, [=](auto& s) { edits(s, family, n, false); });
+                }
+        }
+        for (const auto family: {layouts::Family::Corridors, layouts::Family::Spiral}) {
+                for (const auto n: {64, 256}) {
+                        const auto args = std::string{layouts::name(family)} + "/" + std::to_string(n);
+                        if (n <= 64) { bench::add("what_if<naive>/" + args, [=](auto& s) { obstacles_what_if(s, family, n, true, 1); }); }
+                        for (const auto nthreads: {1u, default_threads()}) {
+                                bench::add("what_if/" + args + "/threads:" + std::to_string(nthreads),
+                                           [=](auto& s) { obstacles_what_if(s, family, n, false, nthreads); });
+                                if (nthreads == default_threads()) { break; }
+                        }
+                }
+        }
+        for (const auto n: {256, 4096}) {
+                bench::add("short_runs<bitset,fresh>/" + std::to_string(n), [=](auto& s) { short_runs<CoverageState>(s, n, true); });
+                bench::add("short_runs<bitset,clear>/" + std::to_string(n), [=](auto& s) { short_runs<CoverageState>(s, n, false); });
+                bench::add("short_runs<epoch>/" + std::to_string(n), [=](auto& s) { short_runs<EpochCoverage>(s, n, false); });
+        }
+        for (const auto n: {64, 256}) {
+                for (const auto nthreads: {1u, default_threads()}) {
+                        bench::add("sweep<all>/" + std::to_string(n) + "/threads:" + std::to_string(nthreads),
+                                   [=](auto& s) { sweep_every(s, n, nthreads); });
+                        if (nthreads == default_threads()) { break; }
+                }
+        }
+        for (const size_t nrobots: {16, 128, 1024}) {
+                for (const auto n: {256, 1024, 4096}) {
+                        for (const auto nthreads: {1u, default_threads()}) {
+                                const auto args = std::to_string(nrobots) + "/" + std::to_string(n) + "/threads:"
+                                                  + std::to_string(nthreads);
+                                bench::add("fleet/" + args,
+                                           [=](auto& s) { run_fleet(s, simulate_fleet, nrobots, n, nthreads); });
+                                bench::add("lockstep/" + args,
+                                           [=](auto& s) { run_fleet(s, simulate_lockstep<TableRepr>, nrobots, n, nthreads); });
+                                if (nthreads == default_threads()) { break; }
+                        }
+                }
+        }
+        for (const auto n: {1024, 4096, 16384}) {
+                bench::add("parse<stream>/" + std::to_string(n), [=](auto& s) { parse_stream(s, n); });
+                bench::add("parse<layout>/" + std::to_string(n), [=](auto& s) { parse_layout(s, n); });
+                bench::add("open_map/" + std::to_string(n), [=](auto& s) { open_file(s, n); });
+        }
+        return bench::run_all(argc, argv);
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A minimal benchmark harness in the style of Google Benchmark, so the bench target needs no dependencies.
+ *
+ * A benchmark is a function of State that does its setup and then loops `for (auto _: state)` over the code being
+ * measured. The runner calls it with a growing iteration count until the loop takes at least MinTime, and reports the
+ * time per iteration plus any counters the benchmark set. Heap allocations are counted globally through the
+ * replaceable operator new, so a benchmark can report allocations per iteration.
+ */
+namespace bench
+{
+        using Clock = std::chrono::steady_clock;
+
+        constexpr auto MinTime = 0.2; // seconds
+
+        /**
+         * @brief No. of calls to operator new so far.
+         */
+        inline auto allocations() -> std::atomic<size_t>&
+        {
+                static std::atomic<size_t> n{};
+                return n;
+        }
+
+        struct Counter
+        {
+                enum Kind { Plain, PerIteration, Rate };
+
+                double value{};
+                Kind   kind{Plain};
+        };
+
+        class State
+        {
+                size_t            iterations, done{};
+                Clock::time_point t0;
+                double            seconds{};
+                size_t            allocs0{}, allocs{};
+
+            public:
+                std::vector<std::pair<std::string, Counter>> counters;
+
+                explicit State(const size_t iterations) : iterations{iterations} {}
+
+                /// What `for (auto _: state)` binds; the user-provided destructor keeps an unused `_` from warning
+                struct Iteration
+                {
+                        ~Iteration() {}
+                };
+
+                struct Iterator
+                {
+                        State* state;
+
+                        auto operator!=(const Iterator&) const -> bool { return state->keep_running(); }
+                        auto operator++() -> Iterator& { return *this; }
+                        auto operator*() const -> Iteration { return {}; }
+                };
+
+                auto begin() -> Iterator
+                {
+                        allocs0 = allocations().load(std::memory_order_relaxed);
+                        t0 = Clock::now();
+                        return {this};
+                }
+
+                auto end() -> Iterator
+                { return {this}; }
+
+                /**
+                 * @brief Sets (or overwrites) a counter reported next to the timing.
+                 */
+                auto counter(const std::string& name, const double value, const Counter::Kind kind = Counter::Plain)
+                {
+                        for (auto& [n, c]: counters) {
+                                if (n == name) { c = Counter{value, kind}; return; }
+                        }
+                        counters.emplace_back(name, Counter{value, kind});
+                }
+
+                [[nodiscard]] auto count() const -> size_t
+                { return iterations; }
+
+                [[nodiscard]] auto elapsed() const -> double
+                { return seconds; }
+
+                /**
+                 * @brief Heap allocations per iteration of the measured loop.
+                 */
+                [[nodiscard]] auto allocations_per_iteration() const -> double
+                { return static_cast<double>(allocs) / static_cast<double>(iterations); }
+
+            private:
+                auto keep_running() -> bool
+                {
+                        if (done < iterations) {
+                                done += 1;
+                                return true;
+                        }
+                        seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+                        allocs  = allocations().load(std::memory_order_relaxed) - allocs0;
+                        return false;
+                }
+        };
+
+        struct Benchmark
+        {
+                std::string                 name;
+                std::function<void(State&)> fn;
+        };
+
+        inline auto registry() -> std::vector<Benchmark>&
+        {
+                static std::vector<Benchmark> benchmarks;
+                return benchmarks;
+        }
+
+        inline auto add(std::string name, std::function<void(State&)> fn) -> void
+        { registry().push_back(Benchmark{std::move(name), std::move(fn)}); }
+
+        /**
+         * @brief Formats a value with an SI suffix, e.g. 12.3M.
+         */
+        inline auto human(double v) -> std::string
+        {
+                const char* suffix = "";
+                for (const auto* s: {"k", "M", "G", "T"}) {
+                        if (v < 1000) { break; }
+                        v /= 1000;
+                        suffix = s;
+                }
+                char buf[32];
+                std::snprintf(buf, sizeof buf, v < 10 ? "%.3g%s" : "%.4g%s", v, suffix);
+                return buf;
+        }
+
+        /**
+         * @brief Runs every registered benchmark whose name contains the filter given as `--filter=<text>`.
+         */
+        inline auto run_all(const int argc, char** argv) -> int
+        {
+                std::string filter;
+                for (int i = 1; i < argc; ++i) {
+                        if (std::strncmp(argv[i], "--filter=", 9) == 0) { filter = argv[i] + 9; }
+                        else {
+                                std::fprintf(stderr, "usage: %s [--filter=<substring>]\n", argv[0]);
+                                return 2;
+                        }
+                }
+
+                std::printf("%-56s %14s %12s  %s\n", "Benchmark", "Time", "Iterations", "Counters");
+                std::printf("%s\n", std::string(120, '-').c_str());
+                for (const auto& b: registry()) {
+                        if (b.name.find(filter) == std::string::npos) { continue; }
+
+                        State state{1};
+                        for (size_t n = 1;; n = std::max(n + 1, static_cast<size_t>(n * std::min(10.0, 1.4 * MinTime / state.elapsed())))) {
+                                state = State{n};
+                                b.fn(state);
+                                if (state.elapsed() >= MinTime || n >= 1000000000) { break; }
+                        }
+
+                        const auto per = state.elapsed() / static_cast<double>(state.count());
+                        const char* unit = "s";
+                        auto t = per;
+                        for (const auto* u: {"ms", "us", "ns"}) {
+                                if (t >= 1) { break; }
+                                t *= 1000;
+                                unit = u;
+                        }
+                        std::printf("%-56s %11.3f %-2s %12zu ", b.name.c_str(), t, unit, state.count());
+                        for (const auto& [name, c]: state.counters) {
+                                auto v = c.value;
+                                if (c.kind == Counter::PerIteration) { v /= static_cast<double>(state.count()); }
+                                if (c.kind == Counter::Rate) { v /= state.elapsed(); }
+                                std::printf(" %s=%s%s", name.c_str(), human(v).c_str(), c.kind == Counter::Rate ? "/s" : "");
+                        }
+                        std::printf("\n");
+                        std::fflush(stdout);
+                }
+                return 0;
+        }
+}
+
+/// Counting allocator hooks; the bench target is the only translation unit that includes this header.
+auto operator new(const size_t n) -> void*
+{
+        bench::allocations().fetch_add(1, std::memory_order_relaxed);
+        if (auto* p = std::malloc(n ? n : 1)) { return p; }
+        throw std::bad_alloc{};
+}
+
+// The deletes are kept out of line: inlined next to a call of operator new, GCC sees free() of a pointer from new and
+// reports -Wmismatched-new-delete, although every new here allocates with malloc or aligned_alloc.
+[[gnu::noinline]] auto operator delete(void* p) noexcept -> void
+{ std::free(p); }
+
+[[gnu::noinline]] auto operator delete(void* p, size_t) noexcept -> void
+{ std::free(p); }
+
+auto operator new(const size_t n, const std::align_val_t align) -> void*
+{
+        bench::allocations().fetch_add(1, std::memory_order_relaxed);
+        const auto a = static_cast<size_t>(align);
+        if (auto* p = std::aligned_alloc(a, (std::max<size_t>(n, 1) + a - 1) / a * a)) { return p; }
+        throw std::bad_alloc{};
+}
+
+[[gnu::noinline]] auto operator delete(void* p, std::align_val_t) noexcept -> void
+{ std::free(p); }
+
+[[gnu::noinline]] auto operator delete(void* p, size_t, std::align_val_t) noexcept -> void
+{ std::free(p); }
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "robot.hpp"
+#include "parallel.hpp"
+
+#include <atomic>
+#include <stdexcept>
+
+/**
+ * @brief A bitset indexed like the MapGeometry plane that concurrent robots update with atomic read-modify-writes.
+ *
+ * Used for the fleet's shared visited state, where set() tells exactly one robot that it cleaned a cell first, and for
+ * the cells the robots stand on.
+ */
+class AtomicBitset
+{
+    public:
+        using Word = MapGeometry::Word;
+
+        static constexpr auto BitsPerWord = MapGeometry::BitsPerWord;
+
+    private:
+        std::vector<std::atomic<Word>> words;
+
+    public:
+        explicit AtomicBitset(const MapGeometry& geometry) : words((geometry.size() + BitsPerWord - 1) / BitsPerWord) {}
+
+        [[nodiscard]] auto test(const size_t i) const -> bool
+        { return (words[i / BitsPerWord].load(std::memory_order_relaxed) >> (i % BitsPerWord)) & 1u; }
+
+        /**
+         * @brief Sets plane index i.
+         * @return true if it was not set before, i.e. this call set it.
+         */
+        auto set(const size_t i) -> bool
+        {
+                const auto bit = Word{1} << (i % BitsPerWord);
+                return !(words[i / BitsPerWord].fetch_or(bit, std::memory_order_relaxed) & bit);
+        }
+
+        auto reset(const size_t i) -> void
+        { words[i / BitsPerWord].fetch_and(~(Word{1} << (i % BitsPerWord)), std::memory_order_relaxed); }
+
+        /**
+         * @brief No. of bits set. Not meant to race with updates.
+         */
+        [[nodiscard]] auto count() const -> size_t
+        {
+                size_t n = 0;
+                for (const auto& w: words) { n += static_cast<size_t>(__builtin_popcountll(w.load(std::memory_order_relaxed))); }
+                return n;
+        }
+};
+
+/**
+ * @brief The moves robots want to make in one tick: 4 bits per cell, bit h set if a robot wants to enter the cell moving
+ * in heading h.
+ *
+ * Robots stand on distinct cells, so at most one robot can approach a cell from each side and the approach heading
+ * identifies the claimant. When several robots want the same cell, the lowest heading (R, D, L, U order) wins, which
+ * depends only on the state at the start of the tick and not on which thread got there first.
+ */
+class ClaimPlane
+{
+        using Word = MapGeometry::Word;
+
+        static constexpr size_t CellsPerWord = MapGeometry::BitsPerWord / DirectionCount;
+
+        std::vector<std::atomic<Word>> words;
+
+    public:
+        explicit ClaimPlane(const MapGeometry& geometry) : words((geometry.size() + CellsPerWord - 1) / CellsPerWord) {}
+
+        auto claim(const size_t i, const Heading h) -> void
+        { words[i / CellsPerWord].fetch_or(bit(i, h), std::memory_order_relaxed); }
+
+        auto release(const size_t i, const Heading h) -> void
+        { words[i / CellsPerWord].fetch_and(~bit(i, h), std::memory_order_relaxed); }
+
+        /**
+         * @brief Obtains the heading of the winning claim on a claimed cell.
+         */
+        [[nodiscard]] auto winner(const size_t i) const -> Heading
+        {
+                const auto claims = words[i / CellsPerWord].load(std::memory_order_relaxed) >> (i % CellsPerWord * DirectionCount);
+                return static_cast<Heading>(__builtin_ctzll(claims & 0xFu));
+        }
+
+    private:
+        static auto bit(const size_t i, const Heading h) -> Word
+        { return Word{1} << (i % CellsPerWord * DirectionCount + static_cast<size_t>(h)); }
+};
+
+struct FleetResult
+{
+        std::vector<size_t> cleaned; // per robot: cells it entered first, its start cell included if no one had it
+        size_t              total;   // distinct cells cleaned by the whole fleet
+        size_t              ticks;   // until every robot had stopped
+};
+
+/**
+ * @brief Runs a fleet of robots concurrently on one map until every robot has stopped.
+ *
+ * Time advances in ticks. In the first phase of a tick every robot looks at the cell ahead: if it is blocked, or
+ * another robot stands on it, the robot will rotate; otherwise it claims the cell. In the second phase each claimant
+ * checks whether it won the cell (see ClaimPlane) and, if so, enters it by setting its bit in the shared visited set:
+ * the robot that sets the bit has cleaned the cell. A robot that loses a claim treats the cell as blocked. Otherwise
+ * every robot follows the single-robot rules of Robot::run, with the visited state shared by the fleet, and a stopped
+ * robot stays where it is as an obstacle. The phases are separated by barriers and only read state from the start of
+ * the tick, so results do not depend on thread count or scheduling.
+ *
+ * Robots are split evenly over the threads, which keep to their own robots for the whole run. Claims go to two planes
+ * used on alternate ticks, so a tick's claims can be cleared while the next tick is being planned.
+ * @param starts Start poses; the robots must start on distinct free cells.
+ * @param nthreads Worker threads, one per hardware thread by default.
+ */
+inline auto simulate_fleet(const MapGeometry& geometry, const std::vector<Pose>& starts,
+                           const unsigned nthreads = default_threads()) -> FleetResult
+{
+        static constexpr auto None = ~size_t{};
+
+        struct Member
+        {
+                BasicPose<TableRepr> pose;
+                size_t               i;       // plane index of pose.p
+                size_t               target;  // cell claimed this tick, or None
+                size_t               claimed; // cell claimed last tick, still to be released, or None
+                Heading              claimed_heading;
+                int                  nblocked;
+                bool                 just_visited;
+                bool                 stopped;
+        };
+
+        FleetResult  result{std::vector<size_t>(starts.size()), 0, 0};
+        AtomicBitset visited{geometry}, occupied{geometry};
+        ClaimPlane   claims[2] = {ClaimPlane{geometry}, ClaimPlane{geometry}};
+
+        std::vector<Member> robots;
+        robots.reserve(starts.size());
+        for (size_t r = 0; r < starts.size(); ++r) {
+                const auto pose = pose_cast<TableRepr>(starts[r]);
+                const auto i    = geometry.index(pose.p);
+                if (geometry.get(i) == CellState::Blocked || !occupied.set(i)) {
+                        throw std::invalid_argument{"robots must start on distinct free cells"};
+                }
+                result.cleaned[r] = visited.set(i);
+                robots.push_back(Member{pose, i, None, None, Heading::R, 0, false, false});
+        }
+
+        const ptrdiff_t stride = geometry.row_stride();
+        const ptrdiff_t delta[DirectionCount] = {1, stride, -1, -stride};
+
+        const auto workers = static_cast<unsigned>(std::clamp<size_t>(nthreads, 1, std::max<size_t>(robots.size(), 1)));
+        SpinBarrier         barrier{workers};
+        std::atomic<size_t> running[3]{}; // robots still running after each tick, in rotation; see below
+
+        const auto work = [&](const unsigned t) {
+                const auto begin = robots.size() * t / workers;
+                const auto end   = robots.size() * (t + 1) / workers;
+                for (size_t tick = 0;; ++tick) {
+                        auto& plane = claims[tick % 2];
+                        // The slot for the next tick was last read at the end of tick - 2, by threads that have all
+                        // passed a barrier since.
+                        if (t == 0) { running[(tick + 1) % 3].store(0, std::memory_order_relaxed); }
+
+                        // Plan: claim the cell ahead, or prepare to rotate.
+                        for (auto r = begin; r < end; ++r) {
+                                auto& robot = robots[r];
+                                if (robot.stopped) { continue; }
+                                const auto h    = robot.pose.d;
+                                const auto next = static_cast<size_t>(static_cast<ptrdiff_t>(robot.i) + delta[static_cast<size_t>(h)]);
+                                robot.target = None;
+                                if (geometry.get(next) != CellState::Blocked && !occupied.test(next)) {
+                                        plane.claim(next, h);
+                                        robot.target = next;
+                                }
+                        }
+                        barrier.wait();
+
+                        // Commit: resolve the claims and move, rotate or stop.
+                        size_t nrunning = 0;
+                        for (auto r = begin; r < end; ++r) {
+                                auto& robot = robots[r];
+                                if (robot.claimed != None) {
+                                        claims[(tick + 1) % 2].release(robot.claimed, robot.claimed_heading);
+                                        robot.claimed = None;
+                                }
+                                if (robot.stopped) { continue; }
+
+                                const auto h = robot.pose.d;
+                                if (robot.target != None) {
+                                        robot.claimed = robot.target;
+                                        robot.claimed_heading = h;
+                                }
+                                if (robot.target == None || plane.winner(robot.target) != h) {
+                                        robot.pose = robot.pose.rotate();
+                                        robot.stopped = ++robot.nblocked == static_cast<int>(DirectionCount);
+                                }
+                                else if (const auto first = visited.set(robot.target); !first && robot.just_visited) {
+                                        robot.stopped = true;
+                                }
+                                else {
+                                        result.cleaned[r] += first;
+                                        robot.just_visited = !first;
+                                        robot.nblocked = 0;
+                                        occupied.reset(robot.i);
+                                        occupied.set(robot.target);
+                                        robot.i = robot.target;
+                                        robot.pose = robot.pose.advance();
+                                }
+                                nrunning += !robot.stopped;
+                        }
+                        running[tick % 3].fetch_add(nrunning, std::memory_order_relaxed);
+                        barrier.wait();
+
+                        if (running[tick % 3].load(std::memory_order_relaxed) == 0) {
+                                if (t == 0) { result.ticks = tick + 1; }
+                                return;
+                        }
+                }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (unsigned t = 1; t < workers; ++t) { threads.emplace_back(work, t); }
+        work(0);
+        for (auto& thread: threads) { thread.join(); }
+
+        result.total = visited.count();
+        return result;
+}
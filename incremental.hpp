@@ -0,0 +1,211 @@
+#pragma once
+
+#include "robot.hpp"
+
+#include <stdexcept>
+
+/**
+ * @brief A recorded Robot::run that can be brought up to date after single-cell map edits without starting over.
+ *
+ * The run is deterministic, so after a cell is toggled it is unchanged up to the first step that peeks at that cell.
+ * While it runs, this records the step at which each cell was first peeked at, the cells in the order they were
+ * marked, and every `interval` steps a checkpoint of the robot's state. After an edit it resumes from the last
+ * checkpoint before the first peek at the edited cell: the marks and first peeks made since the checkpoint are undone,
+ * and the robot runs on from there on the edited map. An edit to a cell the robot never looked at costs nothing.
+ *
+ * The run owns a private copy of the map's plane, which edits change in place; geometry() views it. Copying a run
+ * copies the plane too.
+ */
+class IncrementalRun
+{
+    public:
+        using Word = MapGeometry::Word;
+
+        static constexpr auto None = ~std::uint32_t{};
+
+    private:
+        struct Checkpoint
+        {
+                size_t  step;    // taken before this step
+                size_t  i;       // plane index of the robot
+                size_t  nmarked; // marks.size()
+                Heading h;
+                int     nblocked;
+                bool    just_visited;
+        };
+
+        std::shared_ptr<std::vector<Word>> plane;
+        MapGeometry                        grid;
+        CoverageState                      coverage;
+        size_t                             origin;     // plane index of the start cell
+        size_t                             interval;   // steps between checkpoints
+        std::vector<std::uint32_t>         first_peek; // per plane index: step that first peeked at it, or None
+        std::vector<std::uint32_t>         peeks;      // plane indices in the order they were first peeked at
+        std::vector<std::uint32_t>         marks;      // plane indices in the order they were marked
+        std::vector<Checkpoint>            checkpoints;
+        Checkpoint                         robot;      // current state, step included
+        bool                               stopped;
+        size_t                             nreplayed;  // steps taken by the last run() or toggle()
+
+    public:
+        /**
+         * @param interval Steps between checkpoints; memory for them is 40 bytes per interval steps.
+         */
+        IncrementalRun(const MapGeometry& geometry, const BasicPose<TableRepr> start, const size_t interval = 4096)
+            : plane{std::make_shared<std::vector<Word>>(geometry.data(), geometry.data() + words(geometry))},
+              grid{geometry.shape().first, geometry.shape().second, plane->data(), plane},
+              coverage{grid},
+              origin{grid.index(start.p)},
+              interval{std::max<size_t>(interval, 1)},
+              first_peek(grid.size(), None),
+              robot{0, origin, 0, start.d, 0, false},
+              stopped{},
+              nreplayed{}
+        {
+                // Steps and plane indices are kept in 32 bits.
+                assert(grid.size() < None);
+                if (grid.get(origin) == CellState::Blocked) { throw std::invalid_argument{"the robot must start on a free cell"}; }
+                first_peek[origin] = 0;
+                peeks.push_back(static_cast<std::uint32_t>(origin));
+                coverage.mark(origin, start.p);
+                marks.push_back(static_cast<std::uint32_t>(origin));
+                run();
+        }
+
+        /**
+         * @brief Copies the run along with a private copy of its edited plane, so either can be edited on its own.
+         */
+        IncrementalRun(const IncrementalRun& rhs)
+            : plane{std::make_shared<std::vector<Word>>(*rhs.plane)},
+              grid{rhs.grid.shape().first, rhs.grid.shape().second, plane->data(), plane},
+              coverage{rhs.coverage},
+              origin{rhs.origin},
+              interval{rhs.interval},
+              first_peek{rhs.first_peek},
+              peeks{rhs.peeks},
+              marks{rhs.marks},
+              checkpoints{rhs.checkpoints},
+              robot{rhs.robot},
+              stopped{rhs.stopped},
+              nreplayed{rhs.nreplayed}
+        {}
+
+        IncrementalRun(IncrementalRun&&) noexcept = default;
+
+        auto operator=(const IncrementalRun& rhs) -> IncrementalRun&
+        { return *this = IncrementalRun{rhs}; }
+
+        auto operator=(IncrementalRun&&) noexcept -> IncrementalRun& = default;
+
+        /**
+         * @brief Flips a cell between free and blocked and updates the run.
+         * @param p Cell inside the map, other than the start cell.
+         * @return no. of cells cleaned on the edited map.
+         */
+        auto toggle(const Position p) -> size_t
+        {
+                const auto[w, h] = grid.shape();
+                if (p.x < 0 || p.x >= w || p.y < 0 || p.y >= h) { throw std::invalid_argument{"cell is outside the map"}; }
+                const auto c = grid.index(p);
+                if (c == origin) { throw std::invalid_argument{"cannot toggle the start cell"}; }
+
+                (*plane)[c / MapGeometry::CellsPerWord] ^= Word{static_cast<Word>(CellState::Blocked)} << (c % MapGeometry::CellsPerWord * 2);
+
+                nreplayed = 0;
+                const auto s = first_peek[c];
+                if (s == None) { return cleaned(); }
+
+                // The last checkpoint taken at or before step s; the first one is at step 0.
+                const auto after = std::upper_bound(checkpoints.begin(), checkpoints.end(), size_t{s},
+                                                    [](const size_t step, const Checkpoint& cp) { return step < cp.step; });
+                checkpoints.erase(after, checkpoints.end());
+                robot = checkpoints.back();
+
+                for (; marks.size() > robot.nmarked; marks.pop_back()) { coverage.unmark(marks.back()); }
+                for (; first_peek[peeks.back()] >= robot.step && peeks.back() != origin; peeks.pop_back()) {
+                        first_peek[peeks.back()] = None;
+                }
+                stopped = false;
+                return run();
+        }
+
+        /**
+         * @brief Obtains the step that first peeked at a cell, or None if the run never looked at it; an edit to the cell
+         * re-simulates from there.
+         */
+        [[nodiscard]] auto peeked_at(const Position p) const -> std::uint32_t
+        { return first_peek[grid.index(p)]; }
+
+        /**
+         * @brief The map as edited so far.
+         */
+        [[nodiscard]] auto geometry() const -> const MapGeometry&
+        { return grid; }
+
+        /**
+         * @brief No. of cells cleaned, as returned by Robot::run on geometry().
+         */
+        [[nodiscard]] auto cleaned() const -> size_t
+        { return marks.size(); }
+
+        /**
+         * @brief Steps (peek/move_to iterations, rotations included) of the whole run.
+         */
+        [[nodiscard]] auto steps() const -> size_t
+        { return robot.step; }
+
+        /**
+         * @brief Steps simulated by the last update; the rest of the run was reused.
+         */
+        [[nodiscard]] auto replayed() const -> size_t
+        { return nreplayed; }
+
+    private:
+        static auto words(const MapGeometry& geometry) -> size_t
+        { return MapGeometry::words(geometry.shape().first, geometry.shape().second); }
+
+        /**
+         * @brief Runs on from the current state until the robot stops, recording as it goes.
+         */
+        auto run() -> size_t
+        {
+                const ptrdiff_t stride = grid.row_stride();
+                const ptrdiff_t delta[DirectionCount] = {1, stride, -1, -stride};
+
+                for (auto& [step, i, nmarked, h, nblocked, just_visited] = robot; !stopped; ++step, ++nreplayed) {
+                        assert(step < None);
+                        if (step % interval == 0 && (checkpoints.empty() || checkpoints.back().step != step)) {
+                                nmarked = marks.size();
+                                checkpoints.push_back(robot);
+                        }
+
+                        const auto next = static_cast<size_t>(static_cast<ptrdiff_t>(i) + delta[static_cast<size_t>(h)]);
+                        if (first_peek[next] == None) {
+                                first_peek[next] = static_cast<std::uint32_t>(step);
+                                peeks.push_back(static_cast<std::uint32_t>(next));
+                        }
+
+                        if (coverage.test(next)) {
+                                if (just_visited) {
+                                        stopped = true;
+                                        continue;
+                                }
+                                just_visited = true;
+                                nblocked = 0;
+                                i = next;
+                        }
+                        else if (grid.get(next) == CellState::Blocked) {
+                                h = rotated(h);
+                                stopped = ++nblocked == static_cast<int>(DirectionCount);
+                        }
+                        else {
+                                coverage.mark(next, grid.position(next));
+                                marks.push_back(static_cast<std::uint32_t>(next));
+                                just_visited = false;
+                                nblocked = 0;
+                                i = next;
+                        }
+                }
+                return cleaned();
+        }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "robot.hpp"
+
+#include <random>
+
+/**
+ * Synthetic floor plans used by the benchmarks and the randomised checks. Every generator keeps the origin free so a
+ * robot can always start at (0, 0).
+ */
+namespace layouts
+{
+        /**
+         * @brief Blocks each free cell except the origin with probability density / 100.
+         */
+        inline auto scatter(Map::Layout m, const int density, const unsigned seed = 1) -> Map::Layout
+        {
+                std::mt19937 rng{seed};
+                std::uniform_int_distribution<int> percent{0, 99};
+                for (auto& row: m) {
+                        for (auto& c: row) {
+                                if (c == '.' && percent(rng) < density) { c = 'x'; }
+                        }
+                }
+                m[0][0] = '.';
+                return m;
+        }
+
+        /**
+         * @brief An empty w x h room.
+         */
+        inline auto open(const int w, const int h) -> Map::Layout
+        { return Map::Layout(static_cast<size_t>(h), std::string(static_cast<size_t>(w), '.')); }
+
+        /**
+         * @brief Warehouse aisles: shelving in every third column, broken by a cross aisle every 16 rows.
+         */
+        inline auto corridors(const int w, const int h) -> Map::Layout
+        {
+                auto m = open(w, h);
+                for (int y = 0; y < h; ++y) {
+                        if (y % 16 == 0) { continue; }
+                        for (int x = 2; x < w; x += 3) { m[y][x] = 'x'; }
+                }
+                return m;
+        }
+
+        /**
+         * @brief A single clockwise spiral corridor starting at the origin. The robot follows the corridor to its end,
+         * so the number of steps taken grows with the area of the map.
+         */
+        inline auto spiral(const int w, const int h) -> Map::Layout
+        {
+                Map::Layout m(static_cast<Map::Layout::size_type>(h), std::string(static_cast<size_t>(w), 'x'));
+                const auto inside = [&](const Position p) { return (p.x < w && p.x >= 0) && (p.y < h && p.y >= 0); };
+                const auto free   = [&](const Position p) { return inside(p) && m[p.y][p.x] == '.'; };
+
+                Pose pose{Position{0, 0}, R{}};
+                m[0][0] = '.';
+                for (int turns = 0; turns < 2;) {
+                        const auto next = pose.advance();
+                        const auto far  = next.advance();
+                        if (inside(next.p) && !free(next.p) && !free(far.p)) {
+                                pose = next;
+                                m[pose.p.y][pose.p.x] = '.';
+                                turns = 0;
+                        }
+                        else {
+                                pose = pose.rotate();
+                                turns += 1;
+                        }
+                }
+                return m;
+        }
+
+        enum class Family { Open, Corridors, Spiral };
+
+        constexpr Family Families[] = {Family::Open, Family::Corridors, Family::Spiral};
+
+        inline auto name(const Family f) -> const char*
+        {
+                switch (f) {
+                        case Family::Open: return "open";
+                        case Family::Corridors: return "corridors";
+                        default: return "spiral";
+                }
+        }
+
+        /**
+         * @brief An n x n map of the given family with density percent of its free cells blocked at random.
+         */
+        inline auto make(const Family f, const int n, const int density, const unsigned seed = 1) -> Map::Layout
+        {
+                switch (f) {
+                        case Family::Open: return scatter(open(n, n), density, seed);
+                        case Family::Corridors: return scatter(corridors(n, n), density, seed);
+                        default: return scatter(spiral(n, n), density, seed);
+                }
+        }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "robot.hpp"
+#include "fleet.hpp"
+
+#include <stdexcept>
+
+/**
+ * @brief Runs a fleet of robots in deterministic lockstep on one map until every robot has stopped.
+ *
+ * Every tick has a read phase and a commit phase, built on BasicRobot::plan() and BasicRobot::commit(). In the read
+ * phase, which runs in parallel, each robot peeks at the cell ahead of it; it wants to move there if the cell is free
+ * and no robot stands on it. The wishes go into a reservation table sorted by (cell, robot), and for each cell the
+ * robot with the lowest index gets it. The commit phase then moves, rotates or stops every robot in index order; a
+ * robot whose reservation failed sees the cell as blocked. The map is only read while robots plan and only written
+ * while they commit, so the run is free of data races, and it is the same for any no. of threads.
+ * @tparam Repr Representation the robots run with; TableRepr by default.
+ * @param starts Start poses; the robots must start on distinct free cells.
+ * @param nthreads Threads for the read phase, one per hardware thread by default.
+ * @return per-robot counts (robot i counts its start cell and every cell it entered first), the distinct cells
+ * cleaned, and the no. of ticks.
+ */
+template <class Repr = TableRepr>
+auto simulate_lockstep(const MapGeometry& geometry, const std::vector<Pose>& starts,
+                       const unsigned nthreads = default_threads()) -> FleetResult
+{
+        using Robot = BasicRobot<Repr>;
+
+        struct Reservation
+        {
+                size_t cell, robot;
+
+                auto operator<(const Reservation& rhs) const -> bool
+                { return cell != rhs.cell ? cell < rhs.cell : robot < rhs.robot; }
+        };
+
+        CoverageState coverage{geometry};
+        std::vector<Robot>  robots;
+        std::vector<size_t> occupied; // plane indices the robots stand on, ascending
+        robots.reserve(starts.size());
+        for (const auto& start: starts) {
+                const auto i = geometry.index(start.p);
+                if (geometry.get(i) == CellState::Blocked || coverage.test(i)) {
+                        throw std::invalid_argument{"robots must start on distinct free cells"};
+                }
+                robots.emplace_back(geometry, coverage, pose_cast<Repr>(start), false);
+                occupied.push_back(i);
+        }
+        std::sort(occupied.begin(), occupied.end());
+
+        const auto n = robots.size();
+        std::vector<typename Robot::Cell> cells(n);
+        std::vector<size_t>               targets(n);
+        std::vector<char>                 wants(n), granted(n);
+        std::vector<Reservation>          reservations;
+        reservations.reserve(n);
+
+        const auto workers = static_cast<unsigned>(std::clamp<size_t>(nthreads, 1, std::max<size_t>(n, 1)));
+        SpinBarrier barrier{workers};
+        bool        finished{};
+        size_t      ticks{};
+
+        const auto work = [&](const unsigned t) {
+                const auto begin = n * t / workers;
+                const auto end   = n * (t + 1) / workers;
+                while (true) {
+                        // Read: every running robot looks ahead.
+                        for (auto r = begin; r < end; ++r) {
+                                wants[r] = false;
+                                if (robots[r].done()) { continue; }
+                                cells[r]   = robots[r].plan();
+                                targets[r] = geometry.index(robots[r].pose().advance().p);
+                                wants[r]   = geometry.get(targets[r]) != CellState::Blocked
+                                             && !std::binary_search(occupied.begin(), occupied.end(), targets[r]);
+                        }
+                        barrier.wait();
+
+                        // Commit, on one thread: resolve the reservations, then step the robots in index order.
+                        if (t == 0) {
+                                reservations.clear();
+                                for (size_t r = 0; r < n; ++r) {
+                                        granted[r] = false;
+                                        if (wants[r]) { reservations.push_back(Reservation{targets[r], r}); }
+                                }
+                                std::sort(reservations.begin(), reservations.end());
+                                for (size_t k = 0; k < reservations.size(); ++k) {
+                                        if (k == 0 || reservations[k].cell != reservations[k - 1].cell) {
+                                                granted[reservations[k].robot] = true;
+                                        }
+                                }
+
+                                size_t nrunning = 0;
+                                occupied.clear();
+                                for (size_t r = 0; r < n; ++r) {
+                                        auto& robot = robots[r];
+                                        if (!robot.done()) { robot.commit(cells[r], granted[r]); }
+                                        nrunning += !robot.done();
+                                        occupied.push_back(geometry.index(robot.pose().p));
+                                }
+                                std::sort(occupied.begin(), occupied.end());
+                                ticks += 1;
+                                finished = nrunning == 0;
+                        }
+                        barrier.wait();
+                        if (finished) { return; }
+                }
+        };
+
+        if (n > 0) {
+                std::vector<std::thread> threads;
+                threads.reserve(workers - 1);
+                for (unsigned t = 1; t < workers; ++t) { threads.emplace_back(work, t); }
+                work(0);
+                for (auto& thread: threads) { thread.join(); }
+        }
+
+        FleetResult result{std::vector<size_t>(n), coverage.count(), ticks};
+        for (size_t r = 0; r < n; ++r) { result.cleaned[r] = robots[r].cleaned(); }
+        return result;
+}
@@ -1,287 +1,675 @@
-#include <string>
-#include <vector>
-#include <algorithm>
-#include <optional>
-#include <cstdio>
-#include <variant>
+#include "robot.hpp"
+#include "batch.hpp"
+#include "simd.hpp"
+#include "sweep.hpp"
+#include "incremental.hpp"
+#include "whatif.hpp"
+#include "fleet.hpp"
+#include "lockstep.hpp"
+#include "layouts.hpp"
+#include "map_file.hpp"
+
+#include <filesystem>
+
+namespace
+{
+        /**
+         * @brief Every start pose of a map: each free cell with each heading, in row order.
+         */
+        auto all_starts(const MapGeometry& geometry) -> std::vector<Pose>
+        {
+                const auto[w, h] = geometry.shape();
+                std::vector<Pose> starts;
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) {
+                                if (geometry.state(Position{x, y}) == CellState::Blocked) { continue; }
+                                for (size_t d = 0; d < DirectionCount; ++d) {
+                                        starts.push_back(Pose{Position{x, y}, to_direction(static_cast<Heading>(d))});
+                                }
+                        }
+                }
+                return starts;
+        }
 
-/// Variant helper for using lambdas in-place
-template <class... Ts>
-struct visitor : Ts ... { using Ts::operator()...; };
-template <class... Ts> visitor(Ts...) -> visitor<Ts...>;
+        /**
+         * @brief The result every engine is checked against: an untraced Robot run from the start pose on its own.
+         */
+        auto reference(const MapGeometry& geometry, const Pose start) -> RunResult
+        {
+                CoverageState coverage{geometry};
+                Robot robot{geometry, coverage, start, false};
+                return robot.run(RunLimits{});
+        }
+}
 
-/// Position
-struct Position { int x, y; };
+auto main() -> int
+{
+        struct TestStruct
+        {
+                Map map;
+                int ncleaned{};
+        };
 
-constexpr auto operator==(const Position& lhs, const Position& rhs) -> bool
-{ return (lhs.x == rhs.x) && (lhs.y == rhs.y); }
+        std::vector<TestStruct> Tests{
+                TestStruct{Map{{"....x..", "x......", ".....x.", "......."}}, 15},
+                TestStruct{Map{{"...x..", "....xx", "..x..."}}, 6},
+                TestStruct{Map{{"...x.", ".x..x", "x...x", "..x.."}}, 9},
+                TestStruct{Map{{".", "."}}, 2},
+                TestStruct{Map{{".x"}}, 1},
+                TestStruct{Map{{".", "x"}}, 1},
+        };
 
-/// Direction
-template <int D>
-struct Dir { static constexpr auto value = D; };
+        std::for_each(Tests.begin(), Tests.end(), [i = 0](auto& exp) mutable {
+            exp.map.show();
+            auto table_map = exp.map; // the run marks the map, so copy it for the TableRepr run
+            Robot robot{exp.map, {Position{0, 0}, R{}}};
+            std::printf("Path Traced: \n");
+            const auto got_ncleaned = robot.run();
+            robot.show();
 
-struct R : Dir<1> {}; // Right
-struct D : Dir<1> {}; // Down
-struct L : Dir<-1> {}; // Left
-struct U : Dir<-1> {}; // Up
+            BasicRobot<TableRepr> table_robot{table_map, {Position{0, 0}, Heading::R}};
+            const auto got_table_ncleaned = table_robot.run();
 
-using Direction = std::variant<R, D, L, U>;
+            auto transition_map = table_map.blank();
+            transition_map.build_transitions();
+            Robot transition_robot{transition_map, {Position{0, 0}, R{}}};
+            const auto got_transition_ncleaned = transition_robot.run();
 
-constexpr auto DirectionCount = std::variant_size_v<Direction>;
+            auto jump_map = table_map.blank();
+            Robot jump_robot{jump_map, {Position{0, 0}, R{}}};
+            const auto got_jump_ncleaned = jump_robot.run(ObstaclePlanes{jump_map.geometry()});
 
-constexpr auto operator+(const Position& lhs, const Direction& rhs) -> Position
-{
-        return std::visit(visitor{
-                [&lhs](const R&) -> Position { return {lhs.x + R::value, lhs.y}; },
-                [&lhs](const D&) -> Position { return {lhs.x, lhs.y + D::value}; },
-                [&lhs](const L&) -> Position { return {lhs.x + L::value, lhs.y}; },
-                [&lhs](const U&) -> Position { return {lhs.x, lhs.y + U::value}; },
-        }, rhs);
-}
+            auto distance_map = table_map.blank();
+            Robot distance_robot{distance_map, {Position{0, 0}, R{}}};
+            const auto got_distance_ncleaned = distance_robot.run(distance_map.build_distances());
 
-/// Cell States
-struct Empty { Position pos; }; // Cell available to move into
-struct Visited { Position pos; }; // Cell has been visited previously
-struct Blocked {}; // Cell is occupied
-using Cell = std::variant<Empty, Visited, Blocked>;
+            std::printf("test [%d]: ", i);
+            if (got_ncleaned != static_cast<size_t>(exp.ncleaned)) {
+                    std::printf("FAIL. exp: %d, got: %zu\n", exp.ncleaned, got_ncleaned);
+            }
+            else if (got_table_ncleaned != got_ncleaned) {
+                    std::printf("FAIL. table repr got: %zu, variant repr got: %zu\n", got_table_ncleaned, got_ncleaned);
+            }
+            else if (got_transition_ncleaned != got_ncleaned) {
+                    std::printf("FAIL. transition table got: %zu, exp: %zu\n", got_transition_ncleaned, got_ncleaned);
+            }
+            else if (got_jump_ncleaned != got_ncleaned) {
+                    std::printf("FAIL. jump engine got: %zu, exp: %zu\n", got_jump_ncleaned, got_ncleaned);
+            }
+            else if (got_distance_ncleaned != got_ncleaned) {
+                    std::printf("FAIL. distance table got: %zu, exp: %zu\n", got_distance_ncleaned, got_ncleaned);
+            }
+            else { std::printf("OK\n"); }
+            i++;
+        });
 
-/**
- * @brief Represents the position and heading of the robot.
- */
-struct Pose
-{
-        Position  p; // location
-        Direction d; // heading
+        // The same maps again through the batch API, which runs on blank copies of the (already visited) test maps.
+        std::vector<Map> maps;
+        std::vector<Job> jobs;
+        for (const auto& exp: Tests) {
+                jobs.push_back(Job{maps.size(), {Position{0, 0}, R{}}});
+                maps.push_back(exp.map);
+        }
+        const auto results = simulate_batch(maps, jobs);
+        for (size_t i = 0; i < results.size(); ++i) {
+                std::printf("batch [%zu]: ", i);
+                if (results[i].cleaned != static_cast<size_t>(Tests[i].ncleaned)) {
+                        std::printf("FAIL. exp: %d, got: %zu\n", Tests[i].ncleaned, results[i].cleaned);
+                }
+                else { std::printf("OK\n"); }
+        }
 
-        [[nodiscard]]auto rotate() const
+        // A cancelled batch stops every job at its start; with a step budget each job stops after that many steps.
         {
-                Pose pose{p, d};
-                pose.d = std::visit(visitor{
-                        [](const R&) -> Direction { return D{}; },
-                        [](const D&) -> Direction { return L{}; },
-                        [](const L&) -> Direction { return U{}; },
-                        [](const U&) -> Direction { return R{}; },
-                }, d);
-                return pose;
+                const std::atomic<bool> cancel{true};
+                RunLimits cancelled;
+                cancelled.cancel = &cancel;
+                RunLimits budget;
+                budget.max_steps = 2;
+
+                size_t nfailed{};
+                for (const auto& result: simulate_batch(maps, jobs, 2, cancelled)) {
+                        nfailed += result.termination != Termination::Cancelled || result.cleaned != 1
+                                   || !(result.pose.p == Position{0, 0}) || result.pose.d != Heading::R;
+                }
+                const auto budgeted = simulate_batch(maps, jobs, 2, budget);
+                for (size_t j = 0; j < budgeted.size(); ++j) {
+                        const auto& result = budgeted[j];
+                        nfailed += !finished(result.termination) && (result.termination != Termination::StepBudget || result.cleaned > 3);
+
+                        CoverageState coverage{maps[j].geometry()};
+                        Robot robot{maps[j].geometry(), coverage, jobs[j].pose, false};
+                        const auto exp = robot.run(budget);
+                        nfailed += !(result.pose.p == exp.pose.p) || result.pose.d != exp.pose.d;
+                }
+                std::printf("batch limits: ");
+                if (nfailed != 0) { std::printf("FAIL. %zu jobs\n", nfailed); }
+                else { std::printf("OK\n"); }
         }
 
-        [[nodiscard]]auto advance() const
-        { return Pose{p + d, d}; }
-};
+        // Every start pose of every test map, interleaved, against one run at a time.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto& geometry = Tests[i].map.geometry();
+                const auto starts = all_starts(geometry);
+                const auto got    = run_interleaved(geometry, starts, 3);
+                const auto single = run_interleaved(geometry, starts, 0); // taken as 1
+                const auto wide   = run_interleaved(geometry, starts, starts.size() + 5);
+
+                size_t nfailed{};
+                for (size_t k = 0; k < starts.size(); ++k) {
+                        const auto exp = reference(geometry, starts[k]).cleaned;
+                        nfailed += got[k] != exp || single[k] != exp || wide[k] != exp;
+                }
+                std::printf("interleaved [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu start poses differ\n", nfailed, starts.size()); }
+                else { std::printf("OK\n"); }
+        }
 
-using Poses = std::vector<Pose>;
+        // The same sweep in SIMD lanes, with every kernel this CPU can run.
+        const auto widest = lanes::detect();
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto& geometry = Tests[i].map.geometry();
+                const auto starts = all_starts(geometry);
+
+                std::printf("lanes [%zu]: ", i);
+                std::string failed;
+                for (const auto isa: {lanes::Isa::Scalar, lanes::Isa::Avx2, lanes::Isa::Avx512}) {
+                        if (isa > widest) { break; }
+                        const auto got = run_lanes(geometry, starts, isa);
+                        for (size_t k = 0; k < starts.size(); ++k) {
+                                if (reference(geometry, starts[k]).cleaned != got[k]) {
+                                        failed = failed + " " + lanes::name(isa);
+                                        break;
+                                }
+                        }
+                }
+                if (!failed.empty()) { std::printf("FAIL. differs with%s\n", failed.c_str()); }
+                else { std::printf("OK\n"); }
+        }
 
-/**
- * @brief Map provides a thin wrapper over a Grid object to conveniently access its contents.
- */
-class Map
-{
-    public:
-        using Layout = std::vector<std::string>;
-        using Positions = std::vector<Position>;
+        // Every start pose again, as one sweep.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto& geometry = Tests[i].map.geometry();
+                const auto grid = sweep_all(geometry, 2);
 
-    private:
-        const Layout grid;
-        int          w, h;
-        Positions    visited;
+                // Every free start cleans at least its own cell, so the remaining entries (blocked cells) must be 0.
+                const auto starts = all_starts(geometry);
+                size_t nfailed{};
+                for (const auto& start: starts) { nfailed += grid.at(start.p, to_heading(start.d)) != reference(geometry, start).cleaned; }
+                nfailed += static_cast<size_t>(std::count(grid.data(), grid.data() + grid.size(), 0u)) != grid.size() - starts.size();
 
-    public:
-        explicit Map(Layout g) : grid{std::move(g)}
-        {
-                w = static_cast<int>(grid.front().size());
-                h = static_cast<int>(grid.size());
-                visited.reserve(w * h);
-                visited.push_back(Position{});
+                std::printf("sweep [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu start poses differ\n", nfailed, grid.size()); }
+                else { std::printf("OK\n"); }
         }
 
-        /**
-         * @brief Obtains the value of the cell in the map at the given coordinate.
-         * @param p Coordinate of the cell whose value is requested.
-         * @return Empty if '.' or Blocked if 'x'.
-         */
-        auto operator()(const Position p) const -> Cell
-        {
-                const auto v = get_empty(p).value_or(Blocked{});
-                return find_visited(p).value_or(v);
+        // One epoch-stamped coverage reused for every start pose, with the step loop and the jump engine.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto& geometry = Tests[i].map.geometry();
+                const ObstaclePlanes obstacles{geometry};
+                EpochCoverage epoch{geometry};
+
+                const auto starts = all_starts(geometry);
+                size_t nfailed{};
+                for (const auto& start: starts) {
+                        const auto exp_ncleaned = reference(geometry, start).cleaned;
+
+                        epoch.clear();
+                        BasicRobot<TableRepr, EpochCoverage> stepped{geometry, epoch, pose_cast<TableRepr>(start), false};
+                        nfailed += stepped.run() != exp_ncleaned || epoch.count() != exp_ncleaned;
+                        epoch.clear();
+                        BasicRobot<TableRepr, EpochCoverage> jumped{geometry, epoch, pose_cast<TableRepr>(start), false};
+                        nfailed += jumped.run(obstacles) != exp_ncleaned;
+                }
+                std::printf("epoch [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu start poses differ\n", nfailed, starts.size()); }
+                else { std::printf("OK\n"); }
         }
 
-        /**
-         * @brief Add the given position to the visited list.
-         */
-        auto mark_visited(const Position p)
-        { visited.push_back(p); }
-
-        /**
-         * @brief Computes the no. of cells in the map.
-         */
-        [[nodiscard]] auto count_visited() const -> size_t
-        { return visited.size(); }
-
-        auto show() const
-        {
-                for (const auto& s: grid) {
-                        std::printf("[");
-                        for (const auto& c: s) { std::printf(" %c ", c); }
-                        std::printf("]\n");
+        // Toggling every cell in turn, and back, against a full run on the edited map.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto[w, h] = Tests[i].map.geometry().shape();
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+                IncrementalRun run{Tests[i].map.geometry(), start, 2};
+
+                size_t nfailed{}, nedits{};
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) {
+                                if (x == 0 && y == 0) { continue; }
+                                auto copy = run; // edits to either must not reach the other
+                                size_t toggled{};
+                                for (int k = 0; k < 2; ++k) {
+                                        const auto got = run.toggle(Position{x, y});
+                                        CoverageState coverage{run.geometry()};
+                                        BasicRobot<TableRepr> robot{run.geometry(), coverage, start, false};
+                                        nfailed += robot.run() != got;
+                                        nedits += 1;
+                                        if (k == 0) { toggled = got; }
+                                }
+                                nfailed += copy.toggle(Position{x, y}) != toggled
+                                           || copy.geometry().state(Position{x, y}) == run.geometry().state(Position{x, y});
+                        }
                 }
+                std::printf("incremental [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu edits differ\n", nfailed, nedits); }
+                else { std::printf("OK\n"); }
         }
 
-        [[nodiscard]] auto shape() const -> std::pair<int, int>
-        { return {w, h}; }
+        // Freeing each obstacle, against a full run on a map built with that cell free.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto& geometry = Tests[i].map.geometry();
+                const auto[w, h] = geometry.shape();
+                const BasicPose<TableRepr> start{Position{0, 0}, Heading::R};
+                const auto result = what_if(geometry, start, 2);
+
+                MapGeometry::Layout layout(static_cast<size_t>(h), std::string(static_cast<size_t>(w), '.'));
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) {
+                                if (geometry.state(Position{x, y}) == CellState::Blocked) { layout[y][x] = 'x'; }
+                        }
+                }
+                size_t nfailed{}, nblocked{};
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) {
+                                if (layout[y][x] != 'x') {
+                                        nfailed += result.at(Position{x, y}) != 0;
+                                        continue;
+                                }
+                                auto edited = layout;
+                                edited[y][x] = '.';
+                                const MapGeometry freed{edited};
+                                CoverageState coverage{freed};
+                                BasicRobot<TableRepr> robot{freed, coverage, start, false};
+                                nfailed += robot.run() != result.at(Position{x, y});
+                                nblocked += 1;
+                        }
+                }
+                // Ties go to the earlier cell in row order.
+                const auto top = result.top(nblocked);
+                for (size_t k = 1; k < top.size(); ++k) {
+                        const auto& a = top[k - 1];
+                        const auto& b = top[k];
+                        nfailed += b.cleaned > a.cleaned || (b.cleaned == a.cleaned && std::pair{b.p.y, b.p.x} < std::pair{a.p.y, a.p.x});
+                }
+                nfailed += top.size() != nblocked;
 
-    private:
-        [[nodiscard]] auto find_visited(const Position& p) const -> std::optional<Cell>
-        {
-                const auto pv = std::find(visited.begin(), visited.end(), p);
-                if (pv == visited.end()) { return {}; }
-                return Visited{p};
+                std::printf("what-if [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu obstacles differ\n", nfailed, nblocked); }
+                else { std::printf("OK\n"); }
         }
 
-        [[nodiscard]] auto get_empty(const Position& p) const -> std::optional<Cell>
+        // top() on a heatmap full of ties, against a stable sort of the cells in row order.
         {
-                const auto[x, y] = p;
-                if ((x < w && x >= 0) && (y < h && y >= 0)) {
-                        if (grid[y][x] == '.') { return Empty{p}; }
+                WhatIf ties{40, 30, 1};
+                std::vector<WhatIf::Entry> exp;
+                for (int y = 0; y < 30; ++y) {
+                        for (int x = 0; x < 40; ++x) {
+                                ties.at(Position{x, y}) = static_cast<std::uint32_t>((x * 7 + y * 13) % 4);
+                                if (const auto n = ties.at(Position{x, y})) { exp.push_back(WhatIf::Entry{Position{x, y}, n}); }
+                        }
                 }
-                return {};
-        }
-};
+                std::stable_sort(exp.begin(), exp.end(), [](const auto& lhs, const auto& rhs) { return lhs.cleaned > rhs.cleaned; });
 
+                size_t nfailed{};
+                for (const size_t k: {1, 10, 100, 1200}) {
+                        const auto top = ties.top(k);
+                        nfailed += top.size() != std::min(k, exp.size());
+                        for (size_t j = 0; j < top.size(); ++j) { nfailed += !(top[j].p == exp[j].p) || top[j].cleaned != exp[j].cleaned; }
+                }
+                std::printf("what-if ties: ");
+                if (nfailed != 0) { std::printf("FAIL. %zu entries out of order\n", nfailed); }
+                else { std::printf("OK\n"); }
+        }
 
-/**
- * @brief A cleaning robot that moves through the given Map to clean as many cells as possible. The run() method is the
- * main control loop of the robot which terminates when the robot cannot make progress and returns the no. of clean cells
- * at this time.
- */
-class Robot
-{
-        Map& map;
-        bool  just_visited;
-        int   nblocked;
-        Poses poses;
-
-    public:
-        struct Running { Pose pose; };
-        struct Stopped {};
-        using State = std::variant<Stopped, Running>;
-
-    public:
-        explicit Robot(Map& map, const Pose pose) : map{map}, just_visited{}, nblocked{}
-        {
-                const auto[w, h] = map.shape();
-                poses.reserve(w * h);
-                poses.push_back(pose);
+        // Termination reasons and step budgets, from every start pose.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto& geometry = Tests[i].map.geometry();
+                const auto starts = all_starts(geometry);
+                size_t nfailed{};
+                for (const auto& start: starts) {
+                        CoverageState coverage{geometry};
+                        Robot robot{geometry, coverage, start, false};
+                        const auto exp_ncleaned = robot.run();
+
+                        const auto result = reference(geometry, start);
+                        nfailed += result.cleaned != exp_ncleaned || result.termination == Termination::StepBudget
+                                   || result.termination == Termination::Cycle;
+
+                        CoverageState cut_coverage{geometry};
+                        Robot cut{geometry, cut_coverage, start, false};
+                        const auto partial = cut.run(RunLimits{result.steps - 1});
+                        nfailed += partial.termination != Termination::StepBudget || partial.steps != result.steps - 1
+                                   || partial.cleaned > result.cleaned;
+                }
+                std::printf("termination [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu start poses differ\n", nfailed, starts.size()); }
+                else { std::printf("OK\n"); }
         }
 
-    public:
-        /**
-         * @brief Scans the cell ahead of the robot in its current direction.
-         */
-        auto peek(const Pose pose) -> Cell
-        { return map(pose.advance().p); }
+        // Runs paused by step budgets, a deadline and cancellation, then resumed, against one uninterrupted run.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto& geometry = Tests[i].map.geometry();
+                const auto starts = all_starts(geometry);
+                size_t nfailed{};
+                for (const auto& start: starts) {
+                        const auto exp = reference(geometry, start);
+
+                        std::atomic<bool> cancel{true};
+                        RunLimits limits;
+                        limits.deadline = RunLimits::Clock::now() - std::chrono::seconds{1};
+                        limits.cancel = &cancel;
+                        limits.check_interval = 1;
+
+                        CoverageState paused_coverage{geometry};
+                        Robot paused{geometry, paused_coverage, start, false};
+                        auto got = paused.run(limits);
+                        nfailed += got.termination != Termination::Cancelled || got.steps != 0;
+                        cancel = false;
+                        got = paused.run(limits);
+                        nfailed += got.termination != Termination::Deadline || got.steps != 0;
+
+                        limits = RunLimits{};
+                        limits.max_steps = 3;
+                        size_t steps = 0;
+                        do {
+                                got = paused.run(limits);
+                                steps += got.steps;
+                        }
+                        while (!finished(got.termination));
+                        nfailed += got.cleaned != exp.cleaned || got.termination != exp.termination || steps != exp.steps
+                                   || !(got.pose.p == exp.pose.p) || got.pose.d != exp.pose.d;
+                        nfailed += paused.run(limits).steps != 0 || !paused.done();
+                }
+                std::printf("resume [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu start poses differ\n", nfailed, starts.size()); }
+                else { std::printf("OK\n"); }
+        }
 
-        /**
-         * @brief Moves the robot to the given cell.
-         * @param tgt Cell to move into.
-         * @return Running or Stopped.
-         */
-        auto move_to(const Cell& cell, const Pose& p) -> State
-        {
-                Pose pose = p;
-                return std::visit(visitor{
-                        [&](const Empty& e) -> State {
-                            if (just_visited) { just_visited = false; }
-                            nblocked = 0;
-                            pose.p = e.pos;
-                            map.mark_visited(pose.p);
-                            poses.push_back(pose);
-                            return Running{pose};
-                        },
-                        [&](const Visited& v) -> State {
-                            if (just_visited) { return Stopped{}; }
-                            just_visited = true;
-                            nblocked     = 0;
-                            pose.p = v.pos;
-                            return Running{pose};
-                        },
-                        [&](const Blocked&) -> State {
-                            pose = pose.rotate();
-                            nblocked += 1;
-                            if (nblocked == DirectionCount) { return Stopped{}; }
-                            return Running{pose};
+        // Driving the robot with step() in ticks of 1 and 5 steps, against an uninterrupted run.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto& geometry = Tests[i].map.geometry();
+                const auto starts = all_starts(geometry);
+                size_t nfailed{};
+                for (const auto& start: starts) {
+                        const auto exp = reference(geometry, start);
+
+                        for (const size_t n: {1, 5}) {
+                                CoverageState stepped_coverage{geometry};
+                                Robot stepped{geometry, stepped_coverage, start, false};
+                                size_t ticks = 0;
+                                auto got = stepped.step(n);
+                                for (; std::holds_alternative<Robot::Running>(got.state); got = stepped.step(n)) {
+                                        ticks += 1;
+                                        nfailed += !(std::get<Robot::Running>(got.state).pose.p == got.pose.p);
+                                }
+                                nfailed += stepped.cleaned() != exp.cleaned || !(got.pose.p == exp.pose.p)
+                                           || to_heading(got.pose.d) != exp.pose.d || ticks != (exp.steps - 1) / n
+                                           || !std::holds_alternative<Robot::Stopped>(stepped.step(n).state);
                         }
-                }, cell);
+
+                        // Stopped through commit(), the robot reports the same reason as run().
+                        CoverageState driven_coverage{geometry};
+                        Robot driven{geometry, driven_coverage, start, false};
+                        while (std::holds_alternative<Robot::Running>(driven.commit(driven.plan()))) {}
+                        const auto got = driven.run(RunLimits{});
+                        nfailed += !driven.done() || got.termination != exp.termination || got.steps != 0
+                                   || got.cleaned != exp.cleaned;
+                }
+                std::printf("step [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu start poses differ\n", nfailed, starts.size()); }
+                else { std::printf("OK\n"); }
         }
 
-        /**
-         * @brief Main loop that moves the robot through the map. Terminates when the robot is unable to make progress.
-         * @return no. of cells cleaned in the map.
-         */
-        auto run() -> size_t
-        {
-                auto pose = poses.front(); // always current pose
-                do {
-                        const auto cell  = peek(pose);
-                        const auto state = move_to(cell, pose);
-                        if (std::holds_alternative<Stopped>(state)) { return poses.size(); }
-                        pose = std::get<Running>(state).pose; // update pose
+        // A few steps with step(), then the rest with each run() engine, against an uninterrupted run.
+        for (size_t i = 0; i <= Tests.size(); ++i) {
+                const Map spiral{layouts::spiral(16, 16), false};
+                const auto& geometry = i < Tests.size() ? Tests[i].map.geometry() : spiral.geometry();
+                const TransitionTable transitions{geometry};
+                const ObstaclePlanes obstacles{geometry};
+                const DistanceTable distances{geometry};
+                const LiftingTable lifting{geometry};
+
+                const auto starts = all_starts(geometry);
+                size_t nfailed{};
+                for (const auto& start: starts) {
+                        const auto exp = reference(geometry, start);
+
+                        for (const size_t n: {1, 3, 10}) {
+                                for (size_t engine = 0; engine < 5; ++engine) {
+                                        CoverageState resumed_coverage{geometry};
+                                        Robot resumed{geometry, resumed_coverage, start, false};
+                                        static_cast<void>(resumed.step(n));
+                                        const auto got = engine == 0 ? resumed.run()
+                                                         : engine == 1 ? resumed.run(transitions)
+                                                         : engine == 2 ? resumed.run(obstacles)
+                                                         : engine == 3 ? resumed.run(distances)
+                                                         : resumed.run(lifting);
+                                        const auto again = resumed.run(RunLimits{});
+                                        nfailed += got != exp.cleaned || !resumed.done() || resumed.run() != got
+                                                   || !(resumed.pose().p == exp.pose.p) || to_heading(resumed.pose().d) != exp.pose.d
+                                                   || again.steps != 0 || again.termination != exp.termination;
+                                }
+                        }
                 }
-                while (true);
+                std::printf("resumed run [%zu]: ", i);
+                if (nfailed != 0) { std::printf("FAIL. %zu of %zu start poses differ\n", nfailed, starts.size()); }
+                else { std::printf("OK\n"); }
         }
 
-        auto show() const
-        {
-                const auto[w, h] = map.shape();
+        // Without a trace the robot only counts, so nothing may be allocated from its memory resource.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                CountingResource memory;
+                auto map = Tests[i].map.blank();
+                BasicRobot<TableRepr> robot{map, {Position{0, 0}, Heading::R}, false, &memory};
+                const auto got_ncleaned = robot.run();
+
+                std::printf("untraced [%zu]: ", i);
+                if (got_ncleaned != static_cast<size_t>(Tests[i].ncleaned) || memory.allocations() != 0) {
+                        std::printf("FAIL. exp: %d, got: %zu, allocations: %zu\n",
+                                    Tests[i].ncleaned, got_ncleaned, memory.allocations());
+                }
+                else { std::printf("OK\n"); }
+        }
 
-                Map::Layout m(static_cast<Map::Layout::size_type>(h),
-                              std::string(static_cast<Map::Layout::size_type>(w), '\0'));
+        // A fleet of one robot runs exactly like the robot on its own, in either engine.
+        for (size_t i = 0; i < Tests.size(); ++i) {
+                const auto fleet    = simulate_fleet(Tests[i].map.geometry(), {Pose{Position{0, 0}, R{}}});
+                const auto lockstep = simulate_lockstep<VariantRepr>(Tests[i].map.geometry(), {Pose{Position{0, 0}, R{}}});
+                std::printf("fleet [%zu]: ", i);
+                if (fleet.cleaned.front() != static_cast<size_t>(Tests[i].ncleaned) || fleet.total != fleet.cleaned.front()) {
+                        std::printf("FAIL. exp: %d, got: %zu\n", Tests[i].ncleaned, fleet.cleaned.front());
+                }
+                else if (lockstep.cleaned.front() != fleet.cleaned.front() || lockstep.ticks != fleet.ticks) {
+                        std::printf("FAIL. lockstep got: %zu in %zu ticks, exp: %zu in %zu\n", lockstep.cleaned.front(),
+                                    lockstep.ticks, fleet.cleaned.front(), fleet.ticks);
+                }
+                else { std::printf("OK\n"); }
+        }
 
-                for (const auto& pose: poses) {
-                        const auto dc = std::visit(visitor{
-                                [](const R&) { return 'r'; },
-                                [](const D&) { return 'd'; },
-                                [](const L&) { return 'l'; },
-                                [](const U&) { return 'u'; },
-                        }, pose.d);
+        // A larger fleet gives the same result on any no. of threads, and its per-robot counts add up to the total.
+        {
+                const MapGeometry geometry{layouts::scatter(layouts::open(64, 64), 10)};
+                std::vector<Pose> starts;
+                for (int k = 0; k < 32; ++k) {
+                        const Position p{k * 13 % 64, k * 29 % 64};
+                        if (geometry.state(p) != CellState::Blocked) { starts.push_back(Pose{p, to_direction(static_cast<Heading>(k % 4))}); }
+                }
+                const auto one  = simulate_fleet(geometry, starts, 1);
+                const auto many = simulate_fleet(geometry, starts, 4);
+                size_t sum{};
+                for (const auto n: one.cleaned) { sum += n; }
+
+                std::printf("fleet determinism: ");
+                if (one.cleaned != many.cleaned || one.ticks != many.ticks || sum != one.total) {
+                        std::printf("FAIL. total: %zu vs %zu, ticks: %zu vs %zu\n", one.total, many.total, one.ticks, many.ticks);
+                }
+                else { std::printf("OK\n"); }
+
+                const auto lockstep_one  = simulate_lockstep(geometry, starts, 1);
+                const auto lockstep_many = simulate_lockstep(geometry, starts, 4);
+                sum = 0;
+                for (const auto n: lockstep_one.cleaned) { sum += n; }
+
+                std::printf("lockstep determinism: ");
+                if (lockstep_one.cleaned != lockstep_many.cleaned || lockstep_one.ticks != lockstep_many.ticks
+                    || sum != lockstep_one.total) {
+                        std::printf("FAIL. total: %zu vs %zu, ticks: %zu vs %zu\n", lockstep_one.total, lockstep_many.total,
+                                    lockstep_one.ticks, lockstep_many.ticks);
+                }
+                else { std::printf("OK\n"); }
+        }
 
-                        const auto[x, y] = pose.p;
-                        m[y][x] = dc;
+        // Random maps, start cells and headings: the lifting engine against the reference loop, trace included.
+        std::mt19937 rng{2024};
+        size_t nfailed{};
+        constexpr size_t CorpusSize = 2000;
+        for (size_t k = 0; k < CorpusSize; ++k) {
+                const auto w = 1 + static_cast<int>(rng() % 48), h = 1 + static_cast<int>(rng() % 48);
+                const auto family = k % 2 ? layouts::open(w, h) : layouts::corridors(w, h);
+                auto layout = layouts::scatter(family, static_cast<int>(rng() % 40), rng());
+                const Position p{static_cast<int>(rng() % static_cast<unsigned>(w)), static_cast<int>(rng() % static_cast<unsigned>(h))};
+                layout[p.y][p.x] = '.';
+                const BasicPose<TableRepr> start{p, static_cast<Heading>(rng() % DirectionCount)};
+
+                Map map{layout, false};
+                BasicRobot<TableRepr> robot{map, start};
+                const auto exp_ncleaned = robot.run();
+
+                auto lifted_map = map.blank();
+                BasicRobot<TableRepr> lifted{lifted_map, start};
+                const auto got_ncleaned = lifted.run(LiftingTable{lifted_map.geometry()});
+
+                size_t e = 0;
+                auto same = got_ncleaned == exp_ncleaned;
+                for (const auto& segment: lifted.trace_segments()) {
+                        for (int j = 0; same && j < static_cast<int>(segment.length); ++j, ++e) {
+                                same = e < robot.trace().size() && robot.trace()[e].p == moved(segment.from, segment.heading, j)
+                                       && robot.trace()[e].d == segment.heading;
+                        }
                 }
+                if (!same || e != robot.trace().size()) { nfailed += 1; }
+        }
+        std::printf("corpus [%zu maps]: ", CorpusSize);
+        if (nfailed != 0) { std::printf("FAIL. %zu runs differ from the reference\n", nfailed); }
+        else { std::printf("OK\n"); }
+
+        // The text parser against MapGeometry{layout}: widths around the 16-cell SSE2 chunks and the 32-cell plane
+        // words, fed in random chunks, with CRs, blank lines and with or without a final newline.
+        const auto same_plane = [](const MapGeometry& lhs, const MapGeometry& rhs) {
+                const auto[w, h] = lhs.shape();
+                return lhs.shape() == rhs.shape()
+                       && std::equal(lhs.data(), lhs.data() + MapGeometry::words(w, h), rhs.data());
+        };
+        nfailed = 0;
+        size_t nmaps = 0;
+        for (const auto w: {1, 2, 15, 16, 17, 31, 32, 33, 47, 48, 60, 62, 63, 64, 65, 127, 128, 129, 200}) {
+                for (int k = 0; k < 4; ++k, ++nmaps) {
+                        const auto h = k == 0 ? 1 : 1 + static_cast<int>(rng() % 5); // one row: its last word ends the plane
+                        const auto layout = layouts::scatter(layouts::open(w, h), 50, rng());
+                        std::string text;
+                        for (const auto& row: layout) {
+                                if (rng() % 4 == 0) { text += rng() % 2 ? "\n" : "\r\n"; }
+                                text += row;
+                                if (&row != &layout.back() || k % 2) { text += rng() % 2 ? "\n" : "\r\n"; }
+                        }
 
-                Map _map{m};
-                _map.show();
+                        TextMapParser parser;
+                        for (size_t i = 0; i < text.size();) {
+                                const auto n = std::min<size_t>(1 + rng() % 40, text.size() - i);
+                                parser.feed(text.data() + i, n);
+                                i += n;
+                        }
+                        nfailed += !same_plane(*parser.finish(), MapGeometry{layout});
+                }
+        }
+        std::printf("parser [%zu maps]: ", nmaps);
+        if (nfailed != 0) { std::printf("FAIL. %zu maps differ\n", nfailed); }
+        else { std::printf("OK\n"); }
+
+        // Malformed text is rejected.
+        nfailed = 0;
+        for (const std::string text: {"", "\n\n", "...\n..\n", "..\n...\n", "..\n.a\n", "...\n...\n.", ".\t.\n"}) {
+                try {
+                        TextMapParser parser;
+                        parser.feed(text.data(), text.size());
+                        parser.finish();
+                        nfailed += 1;
+                }
+                catch (const std::system_error&) {}
         }
-};
+        std::printf("parser rejects: ");
+        if (nfailed != 0) { std::printf("FAIL. %zu malformed maps accepted\n", nfailed); }
+        else { std::printf("OK\n"); }
 
-auto main() -> int
-{
-        struct TestStruct
+        // A file's errors name the file and carry the code's message once.
         {
-                Map map;
-                int ncleaned{};
-        };
+                nfailed = 0;
+                const auto path = (std::filesystem::temp_directory_path() / "robot_cleaner_main.txt").string();
+                std::ofstream{path} << "...\n.a.\n";
+                try {
+                        parse_text_map(path);
+                        nfailed += 1;
+                }
+                catch (const std::system_error& e) {
+                        const std::string what = e.what();
+                        const auto message = std::generic_category().message(EINVAL);
+                        const auto first = what.find(message);
+                        nfailed += what.find(path) != 0 || first == std::string::npos || what.find(message, first + 1) != std::string::npos;
+                }
+                std::filesystem::remove(path);
 
-        std::vector<TestStruct> Tests{
-                TestStruct{Map{{"....x..", "x......", ".....x.", "......."}}, 15},
-                TestStruct{Map{{"...x..", "....xx", "..x..."}}, 6},
-                TestStruct{Map{{"...x.", ".x..x", "x...x", "..x.."}}, 9},
-                TestStruct{Map{{".", "."}}, 2},
-                TestStruct{Map{{".x"}}, 1},
-                TestStruct{Map{{".", "x"}}, 1},
-        };
+                std::printf("parser errors: ");
+                if (nfailed != 0) { std::printf("FAIL. the message is malformed\n"); }
+                else { std::printf("OK\n"); }
+        }
 
-        std::for_each(Tests.begin(), Tests.end(), [i = 0](auto& exp) mutable {
-            exp.map.show();
-            Robot robot{exp.map, {Position{0, 0}, R{}}};
-            std::printf("Path Traced: \n");
-            const auto got_ncleaned = robot.run();
-            robot.show();
+        // A map written with save_map opens as the same plane.
+        {
+                const auto path = (std::filesystem::temp_directory_path() / "robot_cleaner_main.rcm").string();
+                const MapGeometry geometry{layouts::scatter(layouts::corridors(70, 9), 20, 3)};
+                save_map(geometry, path);
+                const auto opened = open_map(path, MapCheck::Cells);
+
+                std::printf("map file: ");
+                if (!same_plane(*opened, geometry)) { std::printf("FAIL. the opened plane differs\n"); }
+                else { std::printf("OK\n"); }
+
+                // Overwrites one cell of the saved file; a hole in the border must always be caught, a bad code inside
+                // the map only by the full check.
+                std::ifstream in{path, std::ios::binary};
+                const std::string bytes{std::istreambuf_iterator<char>{in}, {}};
+                const auto corrupt = [&](const size_t i, const CellState s) {
+                        auto copy = bytes;
+                        auto* word = reinterpret_cast<MapGeometry::Word*>(copy.data() + sizeof(MapFileHeader)) + i / MapGeometry::CellsPerWord;
+                        *word = (*word & ~(MapGeometry::Word{3} << (i % MapGeometry::CellsPerWord * 2)))
+                                | static_cast<MapGeometry::Word>(s) << (i % MapGeometry::CellsPerWord * 2);
+                        std::ofstream{path, std::ios::binary | std::ios::trunc}.write(copy.data(), static_cast<std::streamsize>(copy.size()));
+                };
+                const auto rejects = [&path](const MapCheck check) {
+                        try {
+                                static_cast<void>(open_map(path, check));
+                                return false;
+                        }
+                        catch (const std::system_error&) { return true; }
+                };
+
+                const auto[w, h] = geometry.shape();
+                const auto last = geometry.index({-1, h}) - 1; // the end of the padding of the last row
+                nfailed = 0;
+                for (const auto i: {geometry.index({-1, 4}), geometry.index({w, 0}), last, geometry.index({3, -1}), geometry.index({w - 1, h})}) {
+                        corrupt(i, CellState::Empty);
+                        nfailed += !rejects(MapCheck::Border) + !rejects(MapCheck::Cells);
+                }
+                for (const auto i: {geometry.index({0, 0}), geometry.index({w / 2, h / 2}), geometry.index({w - 1, h - 1})}) {
+                        corrupt(i, CellState::Visited);
+                        nfailed += !rejects(MapCheck::Cells);
+                        corrupt(i, static_cast<CellState>(3));
+                        nfailed += !rejects(MapCheck::Cells);
+                }
+                std::filesystem::remove(path);
 
-            std::printf("test [%d]: ", i);
-            if (got_ncleaned != exp.ncleaned) {
-                    std::printf("FAIL. exp: %d, got: %d\n", exp.ncleaned, got_ncleaned);
-            }
-            else { std::printf("OK\n"); }
-            i++;
-        });
-}
\ No newline at end of file
+                std::printf("map file rejects: ");
+                if (nfailed != 0) { std::printf("FAIL. %zu corrupt files accepted\n", nfailed); }
+                else { std::printf("OK\n"); }
+        }
+}
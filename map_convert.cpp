@@ -0,0 +1,19 @@
+#include "map_file.hpp"
+
+/**
+ * @brief Converts a '.'/'x' text map into the binary map format.
+ */
+auto main(int argc, char** argv) -> int
+{
+        if (argc != 3) {
+                std::fprintf(stderr, "usage: %s <map.txt> <map.rcm>\n", argv[0]);
+                return 2;
+        }
+        try {
+                convert_text_map(argv[1], argv[2]);
+        }
+        catch (const std::exception& e) {
+                std::fprintf(stderr, "%s\n", e.what());
+                return 1;
+        }
+}
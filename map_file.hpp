@@ -0,0 +1,324 @@
+#pragma once
+
+#include "robot.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Header of the binary map format.
+ *
+ * A map file is this header followed directly by the MapGeometry plane, exactly as it is laid out in memory (2-bit
+ * CellState codes, bordered and padded rows, host byte order). Opening a file therefore needs no parsing: the plane is
+ * mapped and used in place.
+ */
+struct MapFileHeader
+{
+        static constexpr char Magic[8] = {'R', 'C', 'M', 'A', 'P', '\0', '\0', '1'};
+
+        char          magic[8];
+        std::uint32_t w, h;
+        std::uint64_t words;         // no. of plane words that follow the header
+        std::uint8_t  reserved[40];  // pads the header to 64 bytes so the plane is word aligned
+};
+
+static_assert(sizeof(MapFileHeader) == 64);
+
+/**
+ * @brief Writes the geometry to a binary map file.
+ */
+inline auto save_map(const MapGeometry& geometry, const std::string& path) -> void
+{
+        const auto[w, h] = geometry.shape();
+
+        MapFileHeader header{};
+        std::memcpy(header.magic, MapFileHeader::Magic, sizeof header.magic);
+        header.w     = static_cast<std::uint32_t>(w);
+        header.h     = static_cast<std::uint32_t>(h);
+        header.words = MapGeometry::words(w, h);
+
+        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(&header), sizeof header);
+        out.write(reinterpret_cast<const char*>(geometry.data()),
+                  static_cast<std::streamsize>(header.words * sizeof(MapGeometry::Word)));
+        if (!out) { throw std::system_error{errno, std::generic_category(), "cannot write " + path}; }
+}
+
+/**
+ * @brief How much of a binary map file's plane open_map checks before trusting it.
+ */
+enum class MapCheck
+{
+        Border, // the border and padding around each row: O(h) page touches, the inside is paged in by the robots
+        Cells,  // the border and every cell: reads the whole file; for files that come from outside the program
+};
+
+/**
+ * @brief Checks a plane of MapGeometry::words(w, h) words: the rows above and below the map and the cells left and
+ * right of each row must be Blocked, and with MapCheck::Cells every cell must be Empty or Blocked.
+ */
+inline auto valid_plane(const int w, const int h, const MapGeometry::Word* cells, const MapCheck check) -> bool
+{
+        using Word = MapGeometry::Word;
+
+        const auto blocked   = MapGeometry::filled(CellState::Blocked);
+        const auto row_words = MapGeometry::row_words(w);
+        const auto last      = static_cast<size_t>(h + 1) * row_words;
+        for (size_t i = 0; i < row_words; ++i) {
+                if (cells[i] != blocked || cells[last + i] != blocked) { return false; }
+        }
+
+        // Cell 0 of each row is the left border, cells w + 1 onwards are the right border and padding.
+        const auto right = static_cast<size_t>(w + 1);
+        const auto mask  = ~Word{} << (right % MapGeometry::CellsPerWord * 2);
+        for (size_t row = row_words; row < last; row += row_words) {
+                if ((cells[row] & 3u) != (blocked & 3u)) { return false; }
+                if ((cells[row + right / MapGeometry::CellsPerWord] & mask) != (blocked & mask)) { return false; }
+                for (auto i = right / MapGeometry::CellsPerWord + 1; i < row_words; ++i) {
+                        if (cells[row + i] != blocked) { return false; }
+                }
+        }
+        if (check == MapCheck::Border) { return true; }
+
+        // Empty and Blocked are the codes with the low bit clear.
+        const auto low = MapGeometry::filled(CellState::Visited);
+        return std::all_of(cells, cells + MapGeometry::words(w, h), [low](const Word word) { return (word & low) == 0; });
+}
+
+/**
+ * @brief Opens a binary map file by mapping it into memory, and lives as long as the returned geometry.
+ *
+ * With MapCheck::Border only the border around the map is read up front, so a robot can never walk off the plane;
+ * the cells inside are paged in as the robots touch them and are trusted to be Empty or Blocked. Files that do not
+ * come from save_map in the same program should be opened with MapCheck::Cells.
+ */
+inline auto open_map(const std::string& path, const MapCheck check = MapCheck::Border) -> std::shared_ptr<const MapGeometry>
+{
+        const auto fail = [&path](const char* what) -> std::system_error {
+                return std::system_error{errno, std::generic_category(), std::string{what} + " " + path};
+        };
+
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) { throw fail("cannot open"); }
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                throw fail("cannot stat");
+        }
+        const auto size = static_cast<size_t>(st.st_size);
+        if (size < sizeof(MapFileHeader)) {
+                ::close(fd);
+                errno = EINVAL;
+                throw fail("truncated map file");
+        }
+
+        void* base = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) { throw fail("cannot map"); }
+        std::shared_ptr<const void> mapping{base, [size](const void* p) { ::munmap(const_cast<void*>(p), size); }};
+
+        const auto& header = *static_cast<const MapFileHeader*>(base);
+        const auto  w = static_cast<int>(header.w);
+        const auto  h = static_cast<int>(header.h);
+        if (std::memcmp(header.magic, MapFileHeader::Magic, sizeof header.magic) != 0 || w <= 0 || h <= 0
+            || header.words != MapGeometry::words(w, h)
+            || size < sizeof header + header.words * sizeof(MapGeometry::Word)) {
+                errno = EINVAL;
+                throw fail("not a valid map file");
+        }
+
+        const auto* cells = reinterpret_cast<const MapGeometry::Word*>(static_cast<const char*>(base) + sizeof header);
+        if (!valid_plane(w, h, cells, check)) {
+                errno = EINVAL;
+                throw fail("corrupt map file");
+        }
+        return std::make_shared<const MapGeometry>(w, h, cells, std::move(mapping));
+}
+
+/**
+ * @brief Incremental parser for '.'/'x' text maps, one row per line.
+ *
+ * Text is fed in chunks of any size, so a map never has to be held as text or as a Layout. Cells are classified 16 at
+ * a time with SSE2 where available and written straight into a packed MapGeometry plane that grows by one row at a
+ * time. Only the first row is buffered, until its newline fixes the width; every later row must match it. Blank lines
+ * and CRs are ignored.
+ */
+class TextMapParser
+{
+        using Word = MapGeometry::Word;
+
+        static constexpr auto CellsPerWord = MapGeometry::CellsPerWord;
+
+        std::shared_ptr<std::vector<Word>> plane;
+        std::string                        first;   // the first row, buffered until the width is known
+        int                                w{-1};   // -1 until the first row is complete
+        int                                h{};     // completed rows
+        int                                x{};     // next column of the current row
+        bool                               in_row{};
+        size_t                             row_words{}, line{1};
+
+    public:
+        TextMapParser() : plane{std::make_shared<std::vector<Word>>()} {}
+
+        /**
+         * @brief Consumes the next n bytes of the text.
+         */
+        auto feed(const char* data, const size_t n) -> void
+        {
+                size_t i = 0;
+                while (i < n) {
+#if defined(__SSE2__)
+                        const auto dots = _mm_set1_epi8('.');
+                        const auto xs   = _mm_set1_epi8('x');
+                        while (i + 16 <= n) {
+                                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                                const auto dot  = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, dots)));
+                                const auto cell = dot | static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, xs)));
+                                const auto k    = static_cast<int>(__builtin_ctz(~cell | 0x10000u));
+                                if (k > 0) { put(data + i, dot & ((1u << k) - 1), k); }
+                                i += static_cast<size_t>(k);
+                                if (k < 16) { break; }
+                        }
+#endif
+                        if (i >= n) { break; }
+                        const auto c = data[i++];
+                        if (c == '.' || c == 'x') { put(&c, c == '.', 1); }
+                        else if (c == '\n') {
+                                end_row();
+                                line += 1;
+                        }
+                        else if (c != '\r') { fail("unexpected character"); }
+                }
+        }
+
+        /**
+         * @brief Completes the map once all text has been fed.
+         */
+        auto finish() -> std::shared_ptr<const MapGeometry>
+        {
+                end_row();
+                if (h == 0) { fail("empty map"); }
+                plane->resize(plane->size() + row_words, MapGeometry::filled(CellState::Blocked)); // bottom border
+                const auto* cells = plane->data();
+                return std::make_shared<const MapGeometry>(w, h, cells, std::move(plane));
+        }
+
+    private:
+        [[noreturn]] auto fail(const char* what) const -> void
+        { throw std::system_error{EINVAL, std::generic_category(), std::string{what} + " on line " + std::to_string(line)}; }
+
+        /**
+         * @brief Appends k <= 16 cells to the current row; bit j of dot is set if cell j is '.'.
+         */
+        auto put(const char* s, const std::uint32_t dot, const int k) -> void
+        {
+                if (w < 0) {
+                        first.append(s, static_cast<size_t>(k));
+                        return;
+                }
+                if (!in_row) {
+                        plane->resize(plane->size() + row_words, MapGeometry::filled(CellState::Blocked));
+                        in_row = true;
+                }
+                if (x + k > w) { fail("row longer than the first row"); }
+
+                // Empty is Blocked with the high bit of the 2-bit code cleared.
+                const auto clear = spread(dot) << 1;
+                const auto c     = static_cast<size_t>(h + 1) * row_words * CellsPerWord + static_cast<size_t>(x + 1);
+                const auto shift = c % CellsPerWord * 2;
+                auto*      word  = plane->data() + c / CellsPerWord;
+                word[0] &= ~(clear << shift);
+                // Only touch the next word if the cells cross into it; the row's last word may end the plane.
+                if (c % CellsPerWord + static_cast<size_t>(k) > CellsPerWord) { word[1] &= ~(clear >> (64 - shift)); }
+                x += k;
+        }
+
+        auto end_row() -> void
+        {
+                if (w < 0) {
+                        if (first.empty()) { return; }
+                        w = static_cast<int>(first.size());
+                        row_words = MapGeometry::row_words(w);
+                        plane->resize(row_words, MapGeometry::filled(CellState::Blocked)); // top border
+
+                        const auto row = std::move(first);
+                        for (size_t i = 0; i < row.size(); i += 16) {
+                                const auto k = static_cast<int>(std::min<size_t>(16, row.size() - i));
+                                std::uint32_t dot{};
+                                for (int j = 0; j < k; ++j) { dot |= static_cast<std::uint32_t>(row[i + j] == '.') << j; }
+                                put(row.data() + i, dot, k);
+                        }
+                }
+                if (!in_row) { return; }
+                if (x != w) { fail("row shorter than the first row"); }
+                h += 1;
+                x = 0;
+                in_row = false;
+        }
+
+        /**
+         * @brief Moves bit j of a 16-bit mask to bit 2j, one bit per 2-bit cell code.
+         */
+        static constexpr auto spread(std::uint32_t m) -> Word
+        {
+                m = (m | (m << 8)) & 0x00FF00FFu;
+                m = (m | (m << 4)) & 0x0F0F0F0Fu;
+                m = (m | (m << 2)) & 0x33333333u;
+                m = (m | (m << 1)) & 0x55555555u;
+                return m;
+        }
+};
+
+/**
+ * @brief Parses a text map from a stream, reading it in fixed-size chunks.
+ */
+inline auto parse_text_map(std::FILE* in) -> std::shared_ptr<const MapGeometry>
+{
+        TextMapParser parser;
+        std::vector<char> chunk(size_t{1} << 20);
+        for (size_t n; (n = std::fread(chunk.data(), 1, chunk.size(), in)) > 0;) { parser.feed(chunk.data(), n); }
+        if (std::ferror(in)) { throw std::system_error{errno, std::generic_category(), "cannot read map"}; }
+        return parser.finish();
+}
+
+/**
+ * @brief Parses a text map from a file, or from stdin if the path is "-".
+ */
+inline auto parse_text_map(const std::string& path) -> std::shared_ptr<const MapGeometry>
+{
+        if (path == "-") { return parse_text_map(stdin); }
+
+        const std::unique_ptr<std::FILE, int (*)(std::FILE*)> in{std::fopen(path.c_str(), "rb"), &std::fclose};
+        if (!in) { throw std::system_error{errno, std::generic_category(), "cannot open " + path}; }
+        try {
+                return parse_text_map(in.get());
+        }
+        catch (const std::system_error& e) {
+                // what() already ends with the code's message, which the new error would append a second time.
+                std::string what = e.what();
+                const auto  suffix = ": " + e.code().message();
+                if (what.size() >= suffix.size() && what.compare(what.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                        what.resize(what.size() - suffix.size());
+                }
+                throw std::system_error{e.code(), path + ": " + what};
+        }
+}
+
+/**
+ * @brief Converts a '.'/'x' text map (or stdin, for "-") into a binary map file.
+ */
+inline auto convert_text_map(const std::string& text_path, const std::string& map_path) -> void
+{ save_map(*parse_text_map(text_path), map_path); }
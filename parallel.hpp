@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Default no. of worker threads: one per hardware thread.
+ */
+inline auto default_threads() -> unsigned
+{ return std::max(1u, std::thread::hardware_concurrency()); }
+
+/**
+ * @brief Calls fn(i, worker) for every i in [0, n) on a pool of nthreads workers with work stealing.
+ *
+ * Each worker starts with a contiguous share of the indices and takes them from the front. A worker that runs dry
+ * steals the upper half of the remaining indices of the first victim that still has work, so uneven jobs (a robot that
+ * stops after three steps next to one that cleans a whole floor) keep every thread busy. `worker` is in [0, nthreads)
+ * and can be used to index per-thread scratch state.
+ */
+template <class Fn>
+auto parallel_for(const size_t n, Fn&& fn, unsigned nthreads = default_threads()) -> void
+{
+        nthreads = static_cast<unsigned>(std::clamp<size_t>(nthreads, 1, std::max<size_t>(n, 1)));
+
+        struct Share
+        {
+                std::mutex m;
+                size_t     begin, end;
+        };
+        std::vector<Share> shares(nthreads);
+        for (unsigned t = 0; t < nthreads; ++t) {
+                shares[t].begin = n * t / nthreads;
+                shares[t].end   = n * (t + 1) / nthreads;
+        }
+
+        const auto take = [&](const unsigned t, size_t& i) -> bool {
+                {
+                        std::lock_guard lock{shares[t].m};
+                        if (shares[t].begin < shares[t].end) {
+                                i = shares[t].begin++;
+                                return true;
+                        }
+                }
+                for (unsigned k = 1; k < nthreads; ++k) {
+                        auto& victim = shares[(t + k) % nthreads];
+                        size_t begin, end;
+                        {
+                                std::lock_guard lock{victim.m};
+                                if (victim.begin >= victim.end) { continue; }
+                                begin = victim.begin + (victim.end - victim.begin) / 2;
+                                end   = victim.end;
+                                victim.end = begin;
+                        }
+                        std::lock_guard lock{shares[t].m};
+                        shares[t].begin = begin + 1;
+                        shares[t].end   = end;
+                        i = begin;
+                        return true;
+                }
+                return false;
+        };
+
+        const auto work = [&](const unsigned t) {
+                for (size_t i; take(t, i);) { fn(i, t); }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(nthreads - 1);
+        for (unsigned t = 1; t < nthreads; ++t) { threads.emplace_back(work, t); }
+        work(0);
+        for (auto& thread: threads) { thread.join(); }
+}
+
+/**
+ * @brief Reusable barrier for a fixed set of threads that meet many times in quick succession (e.g. once per tick).
+ *
+ * Waiting threads spin on a generation counter, yielding between polls so that oversubscribed pools still progress.
+ */
+class SpinBarrier
+{
+        const unsigned        nthreads;
+        std::atomic<unsigned> arrived{};
+        std::atomic<unsigned> generation{};
+
+    public:
+        explicit SpinBarrier(const unsigned nthreads) : nthreads{nthreads} {}
+
+        auto wait() -> void
+        {
+                const auto g = generation.load(std::memory_order_acquire);
+                if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == nthreads) {
+                        arrived.store(0, std::memory_order_relaxed);
+                        generation.store(g + 1, std::memory_order_release);
+                        return;
+                }
+                while (generation.load(std::memory_order_acquire) == g) { std::this_thread::yield(); }
+        }
+};
@@ -0,0 +1,1703 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <variant>
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
+#include <memory>
+#include <memory_resource>
+#include <array>
+#include <atomic>
+#include <chrono>
+
+#include "parallel.hpp"
+
+/// Variant helper for using lambdas in-place
+template <class... Ts>
+struct visitor : Ts ... { using Ts::operator()...; };
+template <class... Ts> visitor(Ts...) -> visitor<Ts...>;
+
+/**
+ * @brief A memory resource that forwards to another one and counts the allocations passing through it, so tests and
+ * benchmarks can check what a run allocates.
+ */
+class CountingResource : public std::pmr::memory_resource
+{
+        std::pmr::memory_resource* upstream;
+        size_t                     nallocations{};
+        size_t                     nbytes{};
+
+    public:
+        explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+            : upstream{upstream} {}
+
+        [[nodiscard]] auto allocations() const -> size_t
+        { return nallocations; }
+
+        [[nodiscard]] auto bytes() const -> size_t
+        { return nbytes; }
+
+    private:
+        auto do_allocate(const size_t n, const size_t align) -> void* override
+        {
+                nallocations += 1;
+                nbytes += n;
+                return upstream->allocate(n, align);
+        }
+
+        auto do_deallocate(void* p, const size_t n, const size_t align) -> void override
+        { upstream->deallocate(p, n, align); }
+
+        [[nodiscard]] auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override
+        { return this == &other; }
+};
+
+/// Position
+struct Position { int x, y; };
+
+constexpr auto operator==(const Position& lhs, const Position& rhs) -> bool
+{ return (lhs.x == rhs.x) && (lhs.y == rhs.y); }
+
+/// Direction
+template <int D>
+struct Dir { static constexpr auto value = D; };
+
+struct R : Dir<1> {}; // Right
+struct D : Dir<1> {}; // Down
+struct L : Dir<-1> {}; // Left
+struct U : Dir<-1> {}; // Up
+
+using Direction = std::variant<R, D, L, U>;
+
+constexpr auto DirectionCount = std::variant_size_v<Direction>;
+
+constexpr auto operator+(const Position& lhs, const Direction& rhs) -> Position
+{
+        return std::visit(visitor{
+                [&lhs](const R&) -> Position { return {lhs.x + R::value, lhs.y}; },
+                [&lhs](const D&) -> Position { return {lhs.x, lhs.y + D::value}; },
+                [&lhs](const L&) -> Position { return {lhs.x + L::value, lhs.y}; },
+                [&lhs](const U&) -> Position { return {lhs.x, lhs.y + U::value}; },
+        }, rhs);
+}
+
+/// Compact heading: an index into the dx/dy tables, in clockwise (rotation) order
+enum class Heading : std::uint8_t { R, D, L, U };
+
+constexpr int HeadingDx[DirectionCount] = {R::value, 0, L::value, 0};
+constexpr int HeadingDy[DirectionCount] = {0, D::value, 0, U::value};
+
+constexpr auto operator+(const Position& lhs, const Heading rhs) -> Position
+{
+        const auto i = static_cast<size_t>(rhs);
+        return {lhs.x + HeadingDx[i], lhs.y + HeadingDy[i]};
+}
+
+/**
+ * @brief Obtains the position n cells away in the given heading.
+ */
+constexpr auto moved(const Position& p, const Heading h, const int n) -> Position
+{
+        const auto i = static_cast<size_t>(h);
+        return {p.x + n * HeadingDx[i], p.y + n * HeadingDy[i]};
+}
+
+/**
+ * @brief Obtains the heading after a clockwise quarter turn.
+ */
+constexpr auto rotated(const Direction& d) -> Direction
+{
+        return std::visit(visitor{
+                [](const R&) -> Direction { return D{}; },
+                [](const D&) -> Direction { return L{}; },
+                [](const L&) -> Direction { return U{}; },
+                [](const U&) -> Direction { return R{}; },
+        }, d);
+}
+
+constexpr auto rotated(const Heading h) -> Heading
+{ return static_cast<Heading>((static_cast<size_t>(h) + 1) % DirectionCount); }
+
+constexpr auto to_heading(const Direction& d) -> Heading
+{ return static_cast<Heading>(d.index()); }
+
+constexpr auto to_heading(const Heading h) -> Heading
+{ return h; }
+
+constexpr auto to_direction(const Heading h) -> Direction
+{
+        constexpr Direction directions[DirectionCount] = {R{}, D{}, L{}, U{}};
+        return directions[static_cast<size_t>(h)];
+}
+
+/// Cell States
+struct Empty { Position pos; }; // Cell available to move into
+struct Visited { Position pos; }; // Cell has been visited previously
+struct Blocked {}; // Cell is occupied
+using Cell = std::variant<Empty, Visited, Blocked>;
+
+/// Cell state codes as stored in the packed Map plane (2 bits per cell)
+enum class CellState : std::uint8_t { Empty = 0, Visited = 1, Blocked = 2 };
+
+/**
+ * @brief Representations of headings and cells used by Pose and Robot, selected at compile time.
+ *
+ * VariantRepr is the reference model built on std::variant and std::visit. TableRepr encodes the heading as a Heading
+ * index into the dx/dy tables and cells as CellState bytes, so a step is a few table lookups and integer operations.
+ */
+struct VariantRepr
+{
+        using Direction = ::Direction;
+        using Cell      = ::Cell;
+};
+
+struct TableRepr
+{
+        using Direction = Heading;
+        using Cell      = CellState;
+};
+
+/**
+ * @brief Represents the position and heading of the robot.
+ */
+template <class Repr>
+struct BasicPose
+{
+        Position                 p; // location
+        typename Repr::Direction d; // heading
+
+        [[nodiscard]]auto rotate() const
+        { return BasicPose{p, rotated(d)}; }
+
+        [[nodiscard]]auto advance() const
+        { return BasicPose{p + d, d}; }
+};
+
+/**
+ * @brief Converts a pose to another representation.
+ */
+template <class To, class From>
+constexpr auto pose_cast(const BasicPose<From>& pose) -> BasicPose<To>
+{
+        if constexpr (std::is_same_v<typename To::Direction, Heading>) { return {pose.p, to_heading(pose.d)}; }
+        else { return {pose.p, to_direction(to_heading(pose.d))}; }
+}
+
+using Pose = BasicPose<VariantRepr>;
+using Poses = std::vector<Pose>;
+
+/**
+ * @brief The immutable part of a map: which cells are free and which are blocked.
+ *
+ * Cells are stored as a contiguous plane of 2-bit CellState codes (only Empty and Blocked occur). Each row is
+ * surrounded by a one-cell Blocked border and padded to a whole number of 64-bit words, so any cell adjacent to the map
+ * can be read with an unchecked load. The plane is either owned by the geometry or a view over storage kept alive by
+ * an owner handle (e.g. a memory-mapped file); either way it is never written after construction, so one geometry can
+ * be shared by any number of concurrent runs.
+ */
+class MapGeometry
+{
+    public:
+        using Layout = std::vector<std::string>;
+        using Word = std::uint64_t;
+
+        static constexpr auto CellsPerWord = static_cast<int>(sizeof(Word) * 4);
+        static constexpr auto BitsPerWord  = static_cast<int>(sizeof(Word) * 8);
+
+    private:
+        int                         w, h;
+        int                         stride; // cells per padded row, a multiple of BitsPerWord
+        const Word*                 cells;  // (h + 2) rows of `stride` cells, border included
+        std::shared_ptr<const void> owner;  // keeps `cells` alive
+
+    public:
+        /**
+         * @param g Layout of the map, converted into the packed plane.
+         */
+        explicit MapGeometry(const Layout& g)
+            : w{static_cast<int>(g.front().size())}, h{static_cast<int>(g.size())}, stride{padded(w)}
+        {
+                auto plane = std::make_shared<std::vector<Word>>(words(w, h), filled(CellState::Blocked));
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) {
+                                if (g[y][x] != '.') { continue; }
+                                const auto i = index(Position{x, y});
+                                (*plane)[i / CellsPerWord] &= ~(Word{3} << (i % CellsPerWord * 2));
+                        }
+                }
+                cells = plane->data();
+                owner = std::move(plane);
+        }
+
+        /**
+         * @brief Views an existing packed plane of words(w, h) words without copying it.
+         * @param owner Keeps the plane alive for as long as the geometry exists.
+         */
+        MapGeometry(const int w, const int h, const Word* cells, std::shared_ptr<const void> owner)
+            : w{w}, h{h}, stride{padded(w)}, cells{cells}, owner{std::move(owner)} {}
+
+        /**
+         * @brief Obtains the state of the cell at the given coordinate.
+         * @param p Coordinate of the cell; at most one cell outside the map.
+         * @return Empty if '.', Blocked if 'x' or outside the map.
+         */
+        [[nodiscard]] auto state(const Position p) const -> CellState
+        { return get(index(p)); }
+
+        [[nodiscard]] auto get(const size_t i) const -> CellState
+        { return static_cast<CellState>((cells[i / CellsPerWord] >> (i % CellsPerWord * 2)) & 3u); }
+
+        /**
+         * @brief Obtains the plane index of a coordinate. Indices of adjacent cells differ by 1 (x) or stride() (y).
+         */
+        [[nodiscard]] auto index(const Position& p) const -> size_t
+        {
+                // The border only covers cells adjacent to the map; anything further out is a caller bug.
+                assert((p.x >= -1 && p.x <= w) && (p.y >= -1 && p.y <= h));
+                return static_cast<size_t>(p.y + 1) * stride + (p.x + 1);
+        }
+
+        /**
+         * @brief Obtains the coordinate of a plane index.
+         */
+        [[nodiscard]] auto position(const size_t i) const -> Position
+        { return {static_cast<int>(i % stride) - 1, static_cast<int>(i / stride) - 1}; }
+
+        /**
+         * @brief Total no. of cells in the plane, border and padding included.
+         */
+        [[nodiscard]] auto size() const -> size_t
+        { return static_cast<size_t>(h + 2) * stride; }
+
+        [[nodiscard]] auto row_stride() const -> int
+        { return stride; }
+
+        [[nodiscard]] auto shape() const -> std::pair<int, int>
+        { return {w, h}; }
+
+        [[nodiscard]] auto data() const -> const Word*
+        { return cells; }
+
+        auto show() const
+        {
+                for (int y = 0; y < h; ++y) {
+                        std::printf("[");
+                        for (int x = 0; x < w; ++x) {
+                                std::printf(" %c ", state(Position{x, y}) == CellState::Blocked ? 'x' : '.');
+                        }
+                        std::printf("]\n");
+                }
+        }
+
+        /**
+         * @brief Prints an arbitrary character layout in the same format as show().
+         */
+        static auto show(const Layout& m)
+        {
+                for (const auto& s: m) {
+                        std::printf("[");
+                        for (const auto& c: s) { std::printf(" %c ", c); }
+                        std::printf("]\n");
+                }
+        }
+
+        /**
+         * @brief No. of words in the packed plane of a w x h map.
+         */
+        static constexpr auto words(const int w, const int h) -> size_t
+        { return static_cast<size_t>(h + 2) * row_words(w); }
+
+        /**
+         * @brief No. of words in one padded row of the plane of a map of width w.
+         */
+        static constexpr auto row_words(const int w) -> size_t
+        { return static_cast<size_t>(padded(w) / CellsPerWord); }
+
+        static constexpr auto filled(const CellState s) -> Word
+        { return ~Word{} / 3 * static_cast<Word>(s); }
+
+    private:
+        static constexpr auto padded(const int w) -> int
+        { return (w + 2 + BitsPerWord - 1) / BitsPerWord * BitsPerWord; }
+};
+
+/**
+ * @brief The per-run part of a map: which cells have been visited so far.
+ *
+ * A bitset indexed like the MapGeometry plane, plus an optional ordered trace of the visits. It does not reference the
+ * geometry, so a run needs nothing else of its own.
+ */
+class CoverageState
+{
+    public:
+        using Word = MapGeometry::Word;
+        using Positions = std::pmr::vector<Position>;
+
+        static constexpr auto BitsPerWord = MapGeometry::BitsPerWord;
+
+    private:
+        std::vector<Word> seen;
+        size_t            nvisited;
+        bool              tracing;
+        Positions         visited; // ordered trace of visits, only kept when tracing
+
+    public:
+        /**
+         * @param trace Record the order in which cells are visited. Lookups never consult the trace.
+         * @param memory Where the trace allocates from; it grows geometrically as cells are visited.
+         */
+        explicit CoverageState(const MapGeometry& geometry, const bool trace = false,
+                               std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+            : seen((geometry.size() + BitsPerWord - 1) / BitsPerWord), nvisited{}, tracing{trace}, visited{memory} {}
+
+        [[nodiscard]] auto test(const size_t i) const -> bool
+        { return (seen[i / BitsPerWord] >> (i % BitsPerWord)) & 1u; }
+
+        /**
+         * @brief Marks plane index i (coordinate p) visited.
+         * @return true if it was not visited before.
+         */
+        auto mark(const size_t i, const Position p) -> bool
+        {
+                if (test(i)) { return false; }
+                seen[i / BitsPerWord] |= Word{1} << (i % BitsPerWord);
+                nvisited += 1;
+                if (tracing) { visited.push_back(p); }
+                return true;
+        }
+
+        /**
+         * @brief Clears plane index i again, so a run can be undone cell by cell instead of clearing the whole bitset.
+         * The trace is left alone.
+         */
+        auto unmark(const size_t i) -> void
+        {
+                if (!test(i)) { return; }
+                seen[i / BitsPerWord] &= ~(Word{1} << (i % BitsPerWord));
+                nvisited -= 1;
+        }
+
+        /**
+         * @brief Marks n cells visited, starting at plane index i (coordinate p) and stepping delta indices (heading h)
+         * from one to the next. None of them may be visited yet. Cells along a row are set a word at a time.
+         */
+        auto mark_span(const size_t i, const ptrdiff_t delta, const size_t n, const Position p, const Heading h) -> void
+        {
+                if (delta == 1 || delta == -1) {
+                        const auto first = delta == 1 ? i : i + 1 - n;
+                        for (size_t j = first, end = first + n; j < end;) {
+                                const auto bit = j % BitsPerWord;
+                                const auto k   = std::min<size_t>(BitsPerWord - bit, end - j);
+                                seen[j / BitsPerWord] |= (k == BitsPerWord ? ~Word{} : (Word{1} << k) - 1) << bit;
+                                j += k;
+                        }
+                }
+                else {
+                        for (size_t k = 0, j = i; k < n; ++k, j = static_cast<size_t>(static_cast<ptrdiff_t>(j) + delta)) {
+                                seen[j / BitsPerWord] |= Word{1} << (j % BitsPerWord);
+                        }
+                }
+                nvisited += n;
+                if (tracing) {
+                        const auto[dx, dy] = Position{} + h;
+                        for (int k = 0; k < static_cast<int>(n); ++k) { visited.push_back(Position{p.x + k * dx, p.y + k * dy}); }
+                }
+        }
+
+        /**
+         * @brief Clears n cells marked by mark_span(i, delta, n, ...) again. Like unmark(), leaves the trace alone.
+         */
+        auto unmark_span(const size_t i, const ptrdiff_t delta, const size_t n) -> void
+        {
+                if (delta == 1 || delta == -1) {
+                        const auto first = delta == 1 ? i : i + 1 - n;
+                        for (size_t j = first, end = first + n; j < end;) {
+                                const auto bit = j % BitsPerWord;
+                                const auto k   = std::min<size_t>(BitsPerWord - bit, end - j);
+                                seen[j / BitsPerWord] &= ~((k == BitsPerWord ? ~Word{} : (Word{1} << k) - 1) << bit);
+                                j += k;
+                        }
+                }
+                else {
+                        for (size_t k = 0, j = i; k < n; ++k, j = static_cast<size_t>(static_cast<ptrdiff_t>(j) + delta)) {
+                                seen[j / BitsPerWord] &= ~(Word{1} << (j % BitsPerWord));
+                        }
+                }
+                nvisited -= n;
+        }
+
+        /**
+         * @brief Obtains the no. of cells, at most n, that can be entered from plane index i stepping delta indices at a
+         * time before reaching a visited one. Along a row the bitset is scanned a word at a time.
+         */
+        [[nodiscard]] auto unvisited_run(const size_t i, const ptrdiff_t delta, const size_t n) const -> size_t
+        {
+                if (delta == 1) {
+                        for (size_t j = i + 1, end = i + 1 + n; j < end; j = (j / BitsPerWord + 1) * BitsPerWord) {
+                                if (const auto word = seen[j / BitsPerWord] >> (j % BitsPerWord)) {
+                                        return std::min<size_t>(j + static_cast<size_t>(__builtin_ctzll(word)), end) - (i + 1);
+                                }
+                        }
+                        return n;
+                }
+                if (delta == -1) {
+                        for (size_t j = i - 1, last = i - n; j + 1 > last; j = j / BitsPerWord * BitsPerWord - 1) {
+                                if (const auto word = seen[j / BitsPerWord] << (BitsPerWord - 1 - j % BitsPerWord)) {
+                                        const auto found = j - static_cast<size_t>(__builtin_clzll(word));
+                                        return found < last ? n : i - 1 - found;
+                                }
+                                if (j < BitsPerWord) { break; }
+                        }
+                        return n;
+                }
+                size_t k = 0;
+                for (auto j = i; k < n; ++k) {
+                        j = static_cast<size_t>(static_cast<ptrdiff_t>(j) + delta);
+                        if (test(j)) { break; }
+                }
+                return k;
+        }
+
+        /**
+         * @brief Checks whether any of the plane indices first..last (inclusive, e.g. part of a row) is visited.
+         */
+        [[nodiscard]] auto any(const size_t first, const size_t last) const -> bool
+        {
+                const auto k0 = first / BitsPerWord, k1 = last / BitsPerWord;
+                const auto lo = ~Word{} << (first % BitsPerWord);
+                const auto hi = ~Word{} >> (BitsPerWord - 1 - last % BitsPerWord);
+                if (k0 == k1) { return seen[k0] & lo & hi; }
+                if (seen[k0] & lo || seen[k1] & hi) { return true; }
+                return std::any_of(seen.begin() + static_cast<ptrdiff_t>(k0 + 1), seen.begin() + static_cast<ptrdiff_t>(k1),
+                                   [](const Word w) { return w != 0; });
+        }
+
+        /**
+         * @brief The visited bitset, one bit per plane index.
+         */
+        [[nodiscard]] auto data() const -> const Word*
+        { return seen.data(); }
+
+        /**
+         * @brief Forgets every visit.
+         */
+        auto clear() -> void
+        {
+                std::fill(seen.begin(), seen.end(), Word{});
+                nvisited = 0;
+                visited.clear();
+        }
+
+        [[nodiscard]] auto count() const -> size_t
+        { return nvisited; }
+
+        [[nodiscard]] auto trace() const -> const Positions&
+        { return visited; }
+};
+
+/**
+ * @brief Visited state with a generation stamp per cell instead of a bit: a cell is visited if its stamp equals the
+ * current epoch, so clear() just starts a new epoch.
+ *
+ * Meant for many short runs on one large geometry, where clearing a bitset per run would cost more than the run itself.
+ * It takes 32 bits per cell against CoverageState's one and checks spans cell by cell, so for a single long run the
+ * bitset is the better choice. The stamps are only zeroed when the epoch wraps, once every 2^32 - 1 clears.
+ */
+class EpochCoverage
+{
+    public:
+        using Stamp = std::uint32_t;
+        using Positions = CoverageState::Positions;
+
+    private:
+        std::vector<Stamp> stamps;
+        Stamp              epoch;
+        size_t             nvisited;
+        bool               tracing;
+        Positions          visited; // ordered trace of visits, only kept when tracing
+
+    public:
+        /**
+         * @param trace Record the order in which cells are visited. Lookups never consult the trace.
+         * @param memory Where the trace allocates from; it grows geometrically as cells are visited.
+         */
+        explicit EpochCoverage(const MapGeometry& geometry, const bool trace = false,
+                               std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+            : stamps(geometry.size()), epoch{1}, nvisited{}, tracing{trace}, visited{memory} {}
+
+        [[nodiscard]] auto test(const size_t i) const -> bool
+        { return stamps[i] == epoch; }
+
+        /**
+         * @brief Marks plane index i (coordinate p) visited.
+         * @return true if it was not visited before.
+         */
+        auto mark(const size_t i, const Position p) -> bool
+        {
+                if (test(i)) { return false; }
+                stamps[i] = epoch;
+                nvisited += 1;
+                if (tracing) { visited.push_back(p); }
+                return true;
+        }
+
+        auto unmark(const size_t i) -> void
+        {
+                if (!test(i)) { return; }
+                stamps[i] = 0;
+                nvisited -= 1;
+        }
+
+        /**
+         * @brief Same as CoverageState::mark_span(), one cell at a time.
+         */
+        auto mark_span(const size_t i, const ptrdiff_t delta, const size_t n, const Position p, const Heading h) -> void
+        {
+                const auto[dx, dy] = Position{} + h;
+                for (size_t k = 0, j = i; k < n; ++k, j = static_cast<size_t>(static_cast<ptrdiff_t>(j) + delta)) {
+                        mark(j, Position{p.x + static_cast<int>(k) * dx, p.y + static_cast<int>(k) * dy});
+                }
+        }
+
+        auto unmark_span(const size_t i, const ptrdiff_t delta, const size_t n) -> void
+        {
+                for (size_t k = 0, j = i; k < n; ++k, j = static_cast<size_t>(static_cast<ptrdiff_t>(j) + delta)) { unmark(j); }
+        }
+
+        /**
+         * @brief Same as CoverageState::unvisited_run(), one cell at a time.
+         */
+        [[nodiscard]] auto unvisited_run(const size_t i, const ptrdiff_t delta, const size_t n) const -> size_t
+        {
+                size_t k = 0;
+                for (auto j = i; k < n; ++k) {
+                        j = static_cast<size_t>(static_cast<ptrdiff_t>(j) + delta);
+                        if (test(j)) { break; }
+                }
+                return k;
+        }
+
+        [[nodiscard]] auto any(const size_t first, const size_t last) const -> bool
+        { return std::any_of(stamps.begin() + static_cast<ptrdiff_t>(first), stamps.begin() + static_cast<ptrdiff_t>(last + 1),
+                             [this](const Stamp s) { return s == epoch; }); }
+
+        /**
+         * @brief Forgets every visit by starting a new epoch; O(1) except on wrap-around.
+         */
+        auto clear() -> void
+        {
+                if (++epoch == 0) {
+                        std::fill(stamps.begin(), stamps.end(), Stamp{});
+                        epoch = 1;
+                }
+                nvisited = 0;
+                visited.clear();
+        }
+
+        [[nodiscard]] auto count() const -> size_t
+        { return nvisited; }
+
+        [[nodiscard]] auto trace() const -> const Positions&
+        { return visited; }
+};
+
+/**
+ * @brief Obtains the state of a cell as seen by a run: Visited takes precedence over the geometry.
+ * @tparam Coverage CoverageState or EpochCoverage.
+ */
+template <class Coverage>
+auto cell_state(const MapGeometry& geometry, const Coverage& coverage, const Position p) -> CellState
+{
+        const auto i = geometry.index(p);
+        return coverage.test(i) ? CellState::Visited : geometry.get(i);
+}
+
+inline auto to_cell(const CellState s, const Position p) -> Cell
+{
+        switch (s) {
+                case CellState::Empty: return Empty{p};
+                case CellState::Visited: return Visited{p};
+                default: return Blocked{};
+        }
+}
+
+/**
+ * @brief Precomputed static transitions: for every cell, which of its four neighbours are blocked.
+ *
+ * Blocked cells never change during a run, so the rotations a robot makes at a cell before it can move on depend only
+ * on the cell and its heading. The table stores a 4-bit blocked-neighbour mask per plane index, two cells to a byte, and
+ * resolves (mask, heading) through a 64-entry lookup to the first heading that is not blocked plus the no. of
+ * rotations it takes to get there. A robot walking the table only has to check the visited state of the cell ahead.
+ */
+class TransitionTable
+{
+    public:
+        /// Result of turning at a cell: the heading to leave in and the rotations needed, 4 if every side is blocked
+        struct Turn
+        {
+                Heading      heading;
+                std::uint8_t rotations;
+        };
+
+        static constexpr auto Boxed = std::uint8_t{4};
+
+    private:
+        std::vector<std::uint8_t> masks; // one nibble per cell; bit h set if the neighbour in Heading h is blocked
+
+        static constexpr auto turns = [] {
+                std::array<Turn, 16 * DirectionCount> t{};
+                for (size_t mask = 0; mask < 16; ++mask) {
+                        for (size_t h = 0; h < DirectionCount; ++h) {
+                                auto r = std::uint8_t{0};
+                                while (r < Boxed && ((mask >> ((h + r) % DirectionCount)) & 1u)) { r += 1; }
+                                t[mask * DirectionCount + h] = Turn{static_cast<Heading>((h + r) % DirectionCount), r};
+                        }
+                }
+                return t;
+        }();
+
+    public:
+        explicit TransitionTable(const MapGeometry& geometry) : masks((geometry.size() + 1) / 2, std::uint8_t{0xFF})
+        {
+                const auto[w, h] = geometry.shape();
+                const auto blocked = [&geometry](const Position p) {
+                        return static_cast<std::uint8_t>(geometry.state(p) == CellState::Blocked);
+                };
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) {
+                                const Position p{x, y};
+                                std::uint8_t mask{};
+                                for (size_t d = 0; d < DirectionCount; ++d) {
+                                        mask |= static_cast<std::uint8_t>(blocked(p + static_cast<Heading>(d)) << d);
+                                }
+                                const auto i = geometry.index(p);
+                                masks[i / 2] &= static_cast<std::uint8_t>(~((~mask & 0xFu) << (i % 2 * 4)));
+                        }
+                }
+        }
+
+        /**
+         * @brief Obtains the heading a robot at plane index i facing h leaves in.
+         */
+        [[nodiscard]] auto turn(const size_t i, const Heading h) const -> Turn
+        { return turns[(masks[i / 2] >> (i % 2 * 4) & 0xFu) * DirectionCount + static_cast<size_t>(h)]; }
+
+        /**
+         * @brief Memory used by the table.
+         */
+        [[nodiscard]] auto bytes() const -> size_t
+        { return masks.size() * sizeof(std::uint8_t); }
+};
+
+/**
+ * @brief The blocked cells of a geometry as two bitsets: one row-major and indexed like the plane, one column-major.
+ *
+ * Gives the distance to the next obstacle along a row or column with a count-trailing/leading-zeros per 64 cells
+ * rather than a lookup per cell, at 2 bits per cell.
+ */
+class ObstaclePlanes
+{
+        using Word = MapGeometry::Word;
+
+        static constexpr auto BitsPerWord = MapGeometry::BitsPerWord;
+
+        std::vector<Word> rows;    // bit i set if plane index i is blocked
+        std::vector<Word> cols;    // bit (x + 1) * tstride + (y + 1) set if (x, y) is blocked
+        ptrdiff_t         stride;  // cells per row of `rows`
+        ptrdiff_t         tstride; // cells per column of `cols`, border included, a multiple of BitsPerWord
+
+    public:
+        explicit ObstaclePlanes(const MapGeometry& geometry)
+            : stride{geometry.row_stride()},
+              tstride{(geometry.shape().second + 2 + BitsPerWord - 1) / BitsPerWord * BitsPerWord}
+        {
+                const auto[w, h] = geometry.shape();
+                rows.assign((geometry.size() + BitsPerWord - 1) / BitsPerWord, Word{});
+                cols.assign(static_cast<size_t>((w + 2) * tstride / BitsPerWord), Word{});
+                for (int y = -1; y <= h; ++y) {
+                        for (int x = -1; x <= w; ++x) {
+                                const Position p{x, y};
+                                const auto i = geometry.index(p);
+                                if (geometry.get(i) != CellState::Blocked) { continue; }
+                                rows[i / BitsPerWord] |= Word{1} << (i % BitsPerWord);
+                                const auto t = column_index(p);
+                                cols[t / BitsPerWord] |= Word{1} << (t % BitsPerWord);
+                        }
+                }
+        }
+
+        /**
+         * @brief Obtains the no. of free cells a robot at plane index i (coordinate p) has ahead of it in heading h
+         * before the next blocked one.
+         */
+        [[nodiscard]] auto distance(const size_t i, const Position p, const Heading h) const -> size_t
+        {
+                switch (h) {
+                        case Heading::R: return next_set(rows.data(), i + 1) - i - 1;
+                        case Heading::L: return i - prev_set(rows.data(), i - 1) - 1;
+                        case Heading::D: {
+                                const auto t = column_index(p);
+                                return next_set(cols.data(), t + 1) - t - 1;
+                        }
+                        default: {
+                                const auto t = column_index(p);
+                                return t - prev_set(cols.data(), t - 1) - 1;
+                        }
+                }
+        }
+
+        /**
+         * @brief Memory used by both bitsets.
+         */
+        [[nodiscard]] auto bytes() const -> size_t
+        { return (rows.size() + cols.size()) * sizeof(Word); }
+
+    private:
+        [[nodiscard]] auto column_index(const Position p) const -> size_t
+        { return static_cast<size_t>((p.x + 1) * tstride + (p.y + 1)); }
+
+        /**
+         * @brief Obtains the first index >= from whose bit is set. The border guarantees one.
+         */
+        static auto next_set(const Word* bits, const size_t from) -> size_t
+        {
+                auto k = from / BitsPerWord;
+                auto word = bits[k] >> (from % BitsPerWord);
+                if (word) { return from + static_cast<size_t>(__builtin_ctzll(word)); }
+                while (!(word = bits[++k])) {}
+                return k * BitsPerWord + static_cast<size_t>(__builtin_ctzll(word));
+        }
+
+        /**
+         * @brief Obtains the last index <= from whose bit is set. The border guarantees one.
+         */
+        static auto prev_set(const Word* bits, const size_t from) -> size_t
+        {
+                auto k = from / BitsPerWord;
+                auto word = bits[k] << (BitsPerWord - 1 - from % BitsPerWord);
+                if (word) { return from - static_cast<size_t>(__builtin_clzll(word)); }
+                while (!(word = bits[--k])) {}
+                return k * BitsPerWord + BitsPerWord - 1 - static_cast<size_t>(__builtin_clzll(word));
+        }
+};
+
+/**
+ * @brief Precomputed distances to the next obstacle: for every cell and each of the four headings, the no. of free
+ * cells ahead before a Blocked one.
+ *
+ * Jump-point style: with the table, the static part of a move of any length is one lookup. Distances are stored as
+ * 16-bit values, the four headings of a cell side by side (8 bytes per cell), and saturate at Saturated; a longer
+ * stretch is followed by chaining lookups. The table is built by parallel sweeps, rows for R/L and bands of columns
+ * for D/U, walked row by row so both stay sequential in memory.
+ */
+class DistanceTable
+{
+    public:
+        using Distance = std::uint16_t;
+
+        static constexpr auto Saturated = Distance{0xFFFF};
+
+    private:
+        std::vector<Distance> distances; // [i * DirectionCount + h]
+        ptrdiff_t             stride;
+
+    public:
+        explicit DistanceTable(const MapGeometry& geometry, const unsigned nthreads = default_threads())
+            : distances(geometry.size() * DirectionCount), stride{geometry.row_stride()}
+        {
+                const auto[w, h] = geometry.shape();
+                const auto blocked = [&geometry](const size_t i) { return geometry.get(i) == CellState::Blocked; };
+                const auto step = [](const Distance d) { return d == Saturated ? d : static_cast<Distance>(d + 1); };
+                const auto at = [this](const size_t i, const Heading d) -> Distance& {
+                        return distances[i * DirectionCount + static_cast<size_t>(d)];
+                };
+
+                parallel_for(static_cast<size_t>(h), [&](const size_t y, unsigned) {
+                        const auto row = geometry.index(Position{0, static_cast<int>(y)});
+                        for (size_t x = 0; x < static_cast<size_t>(w); ++x) {
+                                const auto i = row + x;
+                                at(i, Heading::L) = blocked(i - 1) ? 0 : step(at(i - 1, Heading::L));
+                        }
+                        for (auto x = static_cast<size_t>(w); x-- > 0;) {
+                                const auto i = row + x;
+                                at(i, Heading::R) = blocked(i + 1) ? 0 : step(at(i + 1, Heading::R));
+                        }
+                }, nthreads);
+
+                constexpr size_t Band = 64; // columns per task
+                const auto s = static_cast<size_t>(stride);
+                parallel_for((static_cast<size_t>(w) + Band - 1) / Band, [&](const size_t band, unsigned) {
+                        const auto x0 = band * Band;
+                        const auto x1 = std::min(x0 + Band, static_cast<size_t>(w));
+                        for (int y = 0; y < h; ++y) {
+                                const auto row = geometry.index(Position{0, y});
+                                for (auto x = x0; x < x1; ++x) {
+                                        const auto i = row + x;
+                                        at(i, Heading::U) = blocked(i - s) ? 0 : step(at(i - s, Heading::U));
+                                }
+                        }
+                        for (auto y = h; y-- > 0;) {
+                                const auto row = geometry.index(Position{0, y});
+                                for (auto x = x0; x < x1; ++x) {
+                                        const auto i = row + x;
+                                        at(i, Heading::D) = blocked(i + s) ? 0 : step(at(i + s, Heading::D));
+                                }
+                        }
+                }, nthreads);
+        }
+
+        /**
+         * @brief Obtains the no. of free cells ahead of plane index i in heading h before the next blocked one.
+         */
+        [[nodiscard]] auto distance(size_t i, const Position, const Heading h) const -> size_t
+        {
+                const ptrdiff_t delta[DirectionCount] = {1, stride, -1, -stride};
+                size_t n = 0;
+                for (Distance d; (d = distances[i * DirectionCount + static_cast<size_t>(h)]) == Saturated;) {
+                        n += d;
+                        i = static_cast<size_t>(static_cast<ptrdiff_t>(i) + delta[static_cast<size_t>(h)] * d);
+                }
+                return n + distances[i * DirectionCount + static_cast<size_t>(h)];
+        }
+
+        /**
+         * @brief Memory used by the table.
+         */
+        [[nodiscard]] auto bytes() const -> size_t
+        { return distances.size() * sizeof(Distance); }
+};
+
+/**
+ * @brief Binary-lifting (pointer doubling) tables over the static transitions between stretches.
+ *
+ * A node is a pose (cell, heading) a robot can arrive in at the end of a stretch: the cell ahead is blocked and the one
+ * behind is free. From a node the robot turns and runs straight to the next node, and which node that is depends only
+ * on the geometry. Level k holds, for every node, the node 2^k such edges on, the no. of cells entered on the way and
+ * their bounding box. An entry is usable only if the cells it enters are known to be distinct, which composes as
+ * "both halves distinct and their boxes disjoint"; if the box also holds no visited cell, the robot can take the whole
+ * entry without checking cells one by one. Levels are added until no entry is usable any more (or max_levels).
+ *
+ * Marking the cells of a jump is still linear in its length. What a jump saves is the per-stretch visited checks, and
+ * the bounding boxes of paths that wind back on themselves (spirals, obstacle fields) overlap early, so in practice the
+ * levels stay shallow.
+ */
+class LiftingTable
+{
+    public:
+        struct Jump
+        {
+                std::uint32_t next;           // node reached
+                std::uint32_t cells;          // cells entered; 0 if the entry cannot be taken
+                int           x0, y0, x1, y1; // bounding box of the cells entered
+        };
+
+        static constexpr auto None = ~std::uint32_t{};
+
+    private:
+        ObstaclePlanes                  planes;
+        std::vector<std::uint64_t>      keys;   // i * DirectionCount + heading of every node, ascending
+        std::vector<Heading>            leaves; // heading each node's edge leaves in
+        std::vector<std::vector<Jump>>  table;  // table[k][node]
+
+    public:
+        explicit LiftingTable(const MapGeometry& geometry, const size_t max_levels = 24) : planes{geometry}
+        {
+                const auto[w, h] = geometry.shape();
+                const ptrdiff_t stride = geometry.row_stride();
+                const ptrdiff_t delta[DirectionCount] = {1, stride, -1, -stride};
+                const auto blocked = [&geometry](const ptrdiff_t i) {
+                        return geometry.get(static_cast<size_t>(i)) == CellState::Blocked;
+                };
+
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) {
+                                const auto i = static_cast<ptrdiff_t>(geometry.index(Position{x, y}));
+                                if (blocked(i)) { continue; }
+                                for (size_t d = 0; d < DirectionCount; ++d) {
+                                        if (blocked(i + delta[d]) && !blocked(i - delta[d])) {
+                                                keys.push_back(static_cast<std::uint64_t>(i) * DirectionCount + d);
+                                        }
+                                }
+                        }
+                }
+
+                auto& edges = table.emplace_back(keys.size());
+                leaves.resize(keys.size());
+                for (size_t n = 0; n < keys.size(); ++n) {
+                        const auto i = static_cast<size_t>(keys[n] / DirectionCount);
+                        const auto p = geometry.position(i);
+                        auto d = static_cast<Heading>(keys[n] % DirectionCount);
+                        size_t ahead{}, r{};
+                        while (r < DirectionCount && (ahead = planes.distance(i, p, d)) == 0) {
+                                d = rotated(d);
+                                r += 1;
+                        }
+                        leaves[n] = d;
+                        if (r == DirectionCount) {
+                                edges[n] = Jump{static_cast<std::uint32_t>(n), 0, p.x, p.y, p.x, p.y};
+                                continue;
+                        }
+                        const auto first = p + d, last = moved(p, d, static_cast<int>(ahead));
+                        const auto end = static_cast<ptrdiff_t>(i) + delta[static_cast<size_t>(d)] * static_cast<ptrdiff_t>(ahead);
+                        edges[n] = Jump{node(static_cast<size_t>(end), d), static_cast<std::uint32_t>(ahead),
+                                        std::min(first.x, last.x), std::min(first.y, last.y),
+                                        std::max(first.x, last.x), std::max(first.y, last.y)};
+                }
+
+                while (table.size() < max_levels) {
+                        const auto& half = table.back();
+                        std::vector<Jump> level(keys.size());
+                        auto usable = false;
+                        for (size_t n = 0; n < keys.size(); ++n) {
+                                const auto& a = half[n];
+                                const auto& b = half[a.next];
+                                level[n] = Jump{b.next, 0, std::min(a.x0, b.x0), std::min(a.y0, b.y0),
+                                                std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+                                const auto disjoint = a.x1 < b.x0 || b.x1 < a.x0 || a.y1 < b.y0 || b.y1 < a.y0;
+                                if (a.cells != 0 && b.cells != 0 && disjoint) {
+                                        level[n].cells = a.cells + b.cells;
+                                        usable = true;
+                                }
+                        }
+                        if (!usable) { break; }
+                        table.push_back(std::move(level));
+                }
+        }
+
+        /**
+         * @brief Obtains the node of the pose at plane index i facing h, or None if that pose is not a node.
+         */
+        [[nodiscard]] auto node(const size_t i, const Heading h) const -> std::uint32_t
+        {
+                const auto key = static_cast<std::uint64_t>(i) * DirectionCount + static_cast<size_t>(h);
+                const auto it = std::lower_bound(keys.begin(), keys.end(), key);
+                return it != keys.end() && *it == key ? static_cast<std::uint32_t>(it - keys.begin()) : None;
+        }
+
+        [[nodiscard]] auto jump(const size_t k, const std::uint32_t node) const -> const Jump&
+        { return table[k][node]; }
+
+        /**
+         * @brief Obtains the heading the edge out of a node leaves in.
+         */
+        [[nodiscard]] auto leave(const std::uint32_t node) const -> Heading
+        { return leaves[node]; }
+
+        [[nodiscard]] auto levels() const -> size_t
+        { return table.size(); }
+
+        [[nodiscard]] auto nodes() const -> size_t
+        { return keys.size(); }
+
+        /**
+         * @brief The obstacle bitsets used for the stretches taken one at a time.
+         */
+        [[nodiscard]] auto obstacles() const -> const ObstaclePlanes&
+        { return planes; }
+
+        /**
+         * @brief Memory used by the tables, the obstacle bitsets included.
+         */
+        [[nodiscard]] auto bytes() const -> size_t
+        {
+                return planes.bytes() + keys.size() * (sizeof(std::uint64_t) + sizeof(Heading))
+                       + table.size() * keys.size() * sizeof(Jump);
+        }
+};
+
+/// A straight stretch of cells entered one after another: n cells from `from` onwards in heading h
+struct Segment
+{
+        Position      from;
+        Heading       heading;
+        std::uint32_t length;
+};
+
+/// Why a run ended
+enum class Termination : std::uint8_t
+{
+        Stuck,       // blocked in all four headings
+        RevisitStop, // moved onto a visited cell right after moving onto one
+        StepBudget,  // took RunLimits::max_steps steps without stopping
+        Cycle,       // returned to an earlier state, so it would never stop
+        Deadline,    // RunLimits::deadline passed
+        Cancelled,   // RunLimits::cancel was set
+};
+
+inline auto name(const Termination t) -> const char*
+{
+        switch (t) {
+                case Termination::Stuck: return "stuck";
+                case Termination::RevisitStop: return "revisit-stop";
+                case Termination::StepBudget: return "step budget";
+                case Termination::Cycle: return "cycle";
+                case Termination::Deadline: return "deadline";
+                default: return "cancelled";
+        }
+}
+
+/**
+ * @brief Whether a run that ended this way is finished, rather than paused and able to go on.
+ */
+constexpr auto finished(const Termination t) -> bool
+{ return t == Termination::Stuck || t == Termination::RevisitStop || t == Termination::Cycle; }
+
+/// Bounds on a run. The deadline and the cancellation flag are polled every check_interval steps.
+struct RunLimits
+{
+        using Clock = std::chrono::steady_clock;
+
+        size_t                   max_steps = ~size_t{};             // peek/move_to iterations, rotations included
+        Clock::time_point        deadline  = Clock::time_point::max();
+        const std::atomic<bool>* cancel    = nullptr;               // set by another thread to stop the run
+        size_t                   check_interval = 1024;
+};
+
+struct RunResult
+{
+        size_t               cleaned;     // cells cleaned so far, the start included
+        size_t               steps;       // peek/move_to iterations taken by this call, rotations included
+        Termination          termination;
+        BasicPose<TableRepr> pose;        // where the robot is; the next call goes on from here
+};
+
+/**
+ * @brief Map provides a thin wrapper over a Grid object to conveniently access its contents.
+ *
+ * A Map pairs a shared, read-only MapGeometry with its own CoverageState. Copies share the geometry; blank() gives a
+ * copy with nothing visited.
+ */
+class Map
+{
+    public:
+        using Layout = MapGeometry::Layout;
+        using Positions = CoverageState::Positions;
+
+    private:
+        std::shared_ptr<const MapGeometry>     grid;
+        CoverageState                          visits;
+        std::shared_ptr<const TransitionTable> table;     // optional, shared like the geometry
+        std::shared_ptr<const DistanceTable>   distance;  // optional, shared like the geometry
+
+    public:
+        /**
+         * @param g Layout of the map, converted into the packed plane.
+         * @param trace Record the order in which cells are visited. Lookups never consult the trace.
+         */
+        explicit Map(const Layout& g, const bool trace = true)
+            : Map{std::make_shared<const MapGeometry>(g), trace} {}
+
+        explicit Map(std::shared_ptr<const MapGeometry> geometry, const bool trace = true)
+            : grid{std::move(geometry)}, visits{*grid, trace} {}
+
+        /**
+         * @brief Obtains a copy of the map with nothing visited. The geometry is shared, not copied.
+         */
+        [[nodiscard]] auto blank(const bool trace = false) const -> Map
+        {
+                Map m{grid, trace};
+                m.table    = table;
+                m.distance = distance;
+                return m;
+        }
+
+        /**
+         * @brief Precomputes the static transition table, after which robots on this map (and its blank copies) walk
+         * the table instead of peeking through every rotation.
+         */
+        auto build_transitions() -> const TransitionTable&
+        {
+                if (!table) { table = std::make_shared<const TransitionTable>(*grid); }
+                return *table;
+        }
+
+        /**
+         * @brief The transition table, or nullptr if it has not been built.
+         */
+        [[nodiscard]] auto transitions() const -> const TransitionTable*
+        { return table.get(); }
+
+        /**
+         * @brief Precomputes the distance table, a stage of its own so that it is built once and then kept (and shared
+         * by blank copies) with the map. Robots use it through run(*map.distances()).
+         */
+        auto build_distances(const unsigned nthreads = default_threads()) -> const DistanceTable&
+        {
+                if (!distance) { distance = std::make_shared<const DistanceTable>(*grid, nthreads); }
+                return *distance;
+        }
+
+        /**
+         * @brief The distance table, or nullptr if it has not been built.
+         */
+        [[nodiscard]] auto distances() const -> const DistanceTable*
+        { return distance.get(); }
+
+        /**
+         * @brief Obtains the value of the cell in the map at the given coordinate.
+         * @param p Coordinate of the cell whose value is requested; at most one cell outside the map.
+         * @return Empty if '.', Visited if marked or Blocked if 'x' or outside the map.
+         */
+        auto operator()(const Position p) const -> Cell
+        { return to_cell(state(p), p); }
+
+        /**
+         * @brief Obtains the raw state code of the cell at the given coordinate.
+         */
+        [[nodiscard]] auto state(const Position p) const -> CellState
+        { return cell_state(*grid, visits, p); }
+
+        /**
+         * @brief Add the given position to the visited set (and the trace, if enabled).
+         */
+        auto mark_visited(const Position p) -> void
+        { visits.mark(grid->index(p), p); }
+
+        /**
+         * @brief Computes the no. of visited cells in the map.
+         */
+        [[nodiscard]] auto count_visited() const -> size_t
+        { return visits.count(); }
+
+        /**
+         * @brief Visited cells in the order they were marked. Empty unless the map was built with tracing on.
+         */
+        [[nodiscard]] auto trace() const -> const Positions&
+        { return visits.trace(); }
+
+        auto show() const
+        { grid->show(); }
+
+        static auto show(const Layout& m)
+        { MapGeometry::show(m); }
+
+        [[nodiscard]] auto shape() const -> std::pair<int, int>
+        { return grid->shape(); }
+
+        [[nodiscard]] auto geometry() const -> const MapGeometry&
+        { return *grid; }
+
+        [[nodiscard]] auto shared_geometry() const -> const std::shared_ptr<const MapGeometry>&
+        { return grid; }
+
+        [[nodiscard]] auto coverage() -> CoverageState&
+        { return visits; }
+
+        [[nodiscard]] auto coverage() const -> const CoverageState&
+        { return visits; }
+};
+
+/**
+ * @brief A cleaning robot that moves through the given Map to clean as many cells as possible. The run() method is the
+ * main control loop of the robot which terminates when the robot cannot make progress and returns the no. of clean cells
+ * at this time.
+ * @tparam Repr VariantRepr or TableRepr; both produce identical runs.
+ * @tparam Coverage Visited state: CoverageState, or EpochCoverage to reuse one state across many short runs.
+ */
+template <class Repr, class Coverage = CoverageState>
+class BasicRobot
+{
+    public:
+        using Pose  = BasicPose<Repr>;
+        using Poses = std::pmr::vector<Pose>;
+        using Cell  = typename Repr::Cell;
+        using Segments = std::pmr::vector<Segment>;
+
+        struct Running { Pose pose; };
+        struct Stopped {};
+        using State = std::variant<Stopped, Running>;
+
+        /// Outcome of step(): the pose after the last step taken, and Stopped once the robot has stopped
+        struct Stepped
+        {
+                Pose  pose;
+                State state;
+        };
+
+    private:
+        static constexpr auto Tabled = std::is_same_v<Cell, CellState>;
+
+        const MapGeometry&     geometry;
+        Coverage&              coverage;
+        const TransitionTable* transitions; // used by run() when set
+        bool                   just_visited;
+        int                    nblocked;
+        Pose                   start;
+        Pose                   current;     // pose between plan() and commit() steps
+        bool                   halted;      // a commit(), step() or run(const RunLimits&) has stopped the robot
+        Termination            ended;       // why, once halted
+        size_t                 ncleaned;    // cells entered, the start included
+        bool                   tracing;
+        Poses                  poses;       // poses entered, only kept when tracing
+        Segments               segments;    // stretches entered by the jump engine, only kept when tracing
+
+    public:
+        /**
+         * @brief Runs on a shared geometry, recording visits in the given per-run coverage.
+         * @param trace Record every pose entered (needed by show()); otherwise the robot only counts them and run()
+         * never allocates.
+         * @param memory Where the trace allocates from, e.g. an arena reused across runs; it grows geometrically.
+         */
+        BasicRobot(const MapGeometry& geometry, Coverage& coverage, const Pose pose, const bool trace = true,
+                   std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+            : geometry{geometry}, coverage{coverage}, transitions{}, just_visited{}, nblocked{}, start{pose}, current{pose},
+              halted{}, ended{}, ncleaned{1}, tracing{trace}, poses{memory}, segments{memory}
+        {
+                if (tracing) { poses.push_back(pose); }
+                coverage.mark(geometry.index(pose.p), pose.p);
+        }
+
+        explicit BasicRobot(Map& map, const Pose pose, const bool trace = true,
+                            std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+            : BasicRobot{map.geometry(), map.coverage(), pose, trace, memory}
+        { transitions = map.transitions(); }
+
+    public:
+        /**
+         * @brief Scans the cell ahead of the robot in its current direction.
+         */
+        auto peek(const Pose pose) const -> Cell
+        {
+                const auto p = pose.advance().p;
+                if constexpr (Tabled) { return cell_state(geometry, coverage, p); }
+                else { return to_cell(cell_state(geometry, coverage, p), p); }
+        }
+
+        /**
+         * @brief Moves the robot to the given cell.
+         * @param tgt Cell to move into.
+         * @return Running or Stopped.
+         */
+        auto move_to(const Cell& cell, const Pose& p) -> State
+        {
+                if constexpr (Tabled) {
+                        switch (cell) {
+                                case CellState::Empty: return enter_empty(p.advance());
+                                case CellState::Visited: return enter_visited(p.advance());
+                                default: return blocked(p);
+                        }
+                }
+                else {
+                        return std::visit(visitor{
+                                [&](const Empty& e) -> State { return enter_empty(Pose{e.pos, p.d}); },
+                                [&](const Visited& v) -> State { return enter_visited(Pose{v.pos, p.d}); },
+                                [&](const Blocked&) -> State { return blocked(p); },
+                        }, cell);
+                }
+        }
+
+        /**
+         * @brief Read phase of one step: peeks at the cell ahead of the robot's current pose. Changes nothing, so any
+         * number of robots sharing a coverage can plan at the same time.
+         */
+        [[nodiscard]] auto plan() const -> Cell
+        { return peek(current); }
+
+        /**
+         * @brief Commit phase of one step: acts on the cell returned by plan(), moving into it or rotating away.
+         * @param granted false if the robot may not enter the cell after all (e.g. another robot has reserved it), in
+         * which case the cell counts as blocked.
+         */
+        auto commit(const Cell& cell, const bool granted = true) -> State
+        {
+                auto state = granted ? move_to(cell, current) : move_to(blocked_cell(), current);
+                if (const auto* running = std::get_if<Running>(&state)) { current = running->pose; }
+                else { stop(); }
+                return state;
+        }
+
+        /**
+         * @brief Current pose of a robot driven by plan() and commit().
+         */
+        [[nodiscard]] auto pose() const -> const Pose&
+        { return current; }
+
+        /**
+         * @brief Whether commit(), step() or run(const RunLimits&) has stopped the robot for good.
+         */
+        [[nodiscard]] auto done() const -> bool
+        { return halted; }
+
+        /**
+         * @brief No. of cells the robot has cleaned so far, the start included.
+         */
+        [[nodiscard]] auto cleaned() const -> size_t
+        { return ncleaned; }
+
+        /**
+         * @brief Advances the robot by up to n peek/move_to steps from where it is, for callers that drive it a bounded
+         * amount at a time (e.g. once per control tick). Runs exactly the steps of run(), and shares the robot's state
+         * with plan()/commit() and run(const RunLimits&), so the three can be mixed. Never allocates unless tracing, and
+         * then only from the trace's memory resource. Once the robot has stopped, further calls take no steps.
+         */
+        auto step(const size_t n = 1) -> Stepped
+        {
+                if (halted) { return Stepped{current, Stopped{}}; }
+
+                auto pose = current;
+                for (size_t k = 0; k < n; ++k) {
+                        const auto state = move_to(peek(pose), pose);
+                        if (std::holds_alternative<Stopped>(state)) {
+                                stop();
+                                current = pose;
+                                return Stepped{pose, state};
+                        }
+                        pose = std::get<Running>(state).pose;
+                }
+                current = pose;
+                return Stepped{pose, Running{pose}};
+        }
+
+        /**
+         * @brief Main loop that moves the robot through the map. Terminates when the robot is unable to make progress.
+         * Like every run() overload, it goes on from where step(), commit() or a run cut short left the robot, and
+         * takes no steps once it has stopped.
+         * @return no. of cells cleaned in the map.
+         */
+        auto run() -> size_t
+        {
+                if (transitions) { return run(*transitions); }
+                if (halted) { return ncleaned; }
+
+                auto pose = current; // a local, so the loop can keep it in registers
+                do {
+                        const auto cell  = peek(pose);
+                        const auto state = move_to(cell, pose);
+                        if (std::holds_alternative<Stopped>(state)) {
+                                current = pose;
+                                stop();
+                                return ncleaned;
+                        }
+                        pose = std::get<Running>(state).pose; // update pose
+                }
+                while (true);
+        }
+
+        /**
+         * @brief Same as run(), but also reports why the run ended and can be cut short by a step budget, a deadline or a
+         * cancellation flag; a run cut short keeps its state, so calling this again goes on where it stopped.
+         *
+         * Cycles are watched for with Brent's algorithm: the state (pose, just-visited flag, blocked count, cleaned
+         * count) is compared with one saved state each step, and the saved state is replaced after 1, 2, 4, ... steps,
+         * so a cycle is found within a few times its length with O(1) memory and without a trace. Under the current
+         * rules a robot that cleans nothing stops within a few steps, so Cycle never occurs; the check guards the rules
+         * rather than the maps. The clock and the flag are only read every limits.check_interval steps.
+         */
+        auto run(const RunLimits& limits) -> RunResult
+        {
+                struct Snapshot
+                {
+                        Position p;
+                        Heading  h;
+                        bool     just_visited;
+                        int      nblocked;
+                        size_t   ncleaned;
+
+                        auto operator==(const Snapshot& rhs) const -> bool
+                        {
+                                return p == rhs.p && h == rhs.h && just_visited == rhs.just_visited
+                                       && nblocked == rhs.nblocked && ncleaned == rhs.ncleaned;
+                        }
+                };
+
+                auto pose = current; // a local, so the loop can keep it in registers
+                const auto result = [&](const size_t steps, const Termination t) {
+                        current = pose;
+                        if (finished(t)) {
+                                halted = true;
+                                ended = t;
+                        }
+                        return RunResult{ncleaned, steps, t, pose_cast<TableRepr>(pose)};
+                };
+                if (halted) { return result(0, ended); }
+
+                const auto interval = std::max<size_t>(limits.check_interval, 1);
+                const auto timed = limits.deadline != RunLimits::Clock::time_point::max();
+                const auto snapshot = [&] { return Snapshot{pose.p, to_heading(pose.d), just_visited, nblocked, ncleaned}; };
+                auto   saved = snapshot();
+                size_t power = 1, lambda = 0;
+                for (size_t steps = 0, check = 0;; ) {
+                        if (steps == limits.max_steps) { return result(steps, Termination::StepBudget); }
+                        if (steps == check) {
+                                check += interval;
+                                if (limits.cancel && limits.cancel->load(std::memory_order_relaxed)) {
+                                        return result(steps, Termination::Cancelled);
+                                }
+                                if (timed && RunLimits::Clock::now() >= limits.deadline) { return result(steps, Termination::Deadline); }
+                        }
+
+                        const auto state = move_to(peek(pose), pose);
+                        steps += 1;
+                        if (std::holds_alternative<Stopped>(state)) { return result(steps, stop()); }
+                        pose = std::get<Running>(state).pose;
+
+                        if (snapshot() == saved) { return result(steps, Termination::Cycle); }
+                        if (++lambda == power) {
+                                saved  = snapshot();
+                                power *= 2;
+                                lambda = 0;
+                        }
+                }
+        }
+
+        /**
+         * @brief Same as run(), but resolves rotations through the precomputed table so that each iteration is one
+         * table lookup and one visited check. Produces exactly the result of run().
+         */
+        auto run(const TransitionTable& table) -> size_t
+        {
+                const ptrdiff_t stride = geometry.row_stride();
+                const ptrdiff_t delta[DirectionCount] = {1, stride, -1, -stride};
+                if (halted) { return ncleaned; }
+
+                auto p = current.p;
+                auto h = to_heading(current.d);
+                auto i = geometry.index(p);
+                while (true) {
+                        const auto turn = table.turn(i, h);
+                        if (turn.rotations == TransitionTable::Boxed) {
+                                // Stop where step() would: after the rotations left, short of the last one.
+                                for (; nblocked + 1 < static_cast<int>(DirectionCount); ++nblocked) { h = rotated(h); }
+                                nblocked += 1;
+                                return stopped_at(p, h);
+                        }
+                        h = turn.heading;
+
+                        const auto next = static_cast<size_t>(static_cast<ptrdiff_t>(i) + delta[static_cast<size_t>(h)]);
+                        if (coverage.test(next)) {
+                                if (just_visited) { return stopped_at(p, h); }
+                                just_visited = true;
+                        }
+                        else {
+                                just_visited = false;
+                                coverage.mark(next, p + h);
+                                ncleaned += 1;
+                                if (tracing) { poses.push_back(pose_cast<Repr>(BasicPose<TableRepr>{p + h, h})); }
+                        }
+                        nblocked = 0;
+                        i = next;
+                        p = p + h;
+                }
+        }
+
+        /**
+         * @brief Same as run(), but enters every straight stretch of empty cells in one step: the obstacles give the
+         * distance to the next blocked cell, the visited bitset shortens it to the next visited one, the cells are marked
+         * in bulk, and the trace gets one Segment for the stretch instead of a pose per cell. Rotations and moves onto
+         * visited cells are taken one at a time as in run(). Produces exactly the result of run(), and trace_segments()
+         * expands to its trace.
+         * @tparam Obstacles ObstaclePlanes or DistanceTable.
+         */
+        template <class Obstacles>
+        auto run(const Obstacles& obstacles) -> decltype(obstacles.distance(size_t{}, Position{}, Heading{}), size_t{})
+        {
+                if (halted) { return ncleaned; }
+
+                auto p = current.p;
+                auto h = to_heading(current.d);
+                auto i = geometry.index(p);
+                if (tracing && segments.empty()) { segments.push_back(Segment{start.p, to_heading(start.d), 1}); }
+                while (stretch(obstacles, i, p, h)) {}
+                return stopped_at(p, h);
+        }
+
+        /**
+         * @brief Same as run(const Obstacles&), but whenever the robot arrives at a LiftingTable node it tries to take
+         * 2^k node-to-node edges at once: an entry whose cells are known to be distinct and whose bounding box holds no
+         * visited cell is entered without any visited checks, its edges replayed to mark the cells. Anything else is
+         * taken one stretch at a time. Produces exactly the result of run().
+         */
+        auto run(const LiftingTable& lifting) -> size_t
+        {
+                const auto& obstacles = lifting.obstacles();
+                if (halted) { return ncleaned; }
+
+                auto p = current.p;
+                auto h = to_heading(current.d);
+                auto i = geometry.index(p);
+                if (tracing && segments.empty()) { segments.push_back(Segment{start.p, to_heading(start.d), 1}); }
+                for (size_t k = 0;;) {
+                        auto node = obstacles.distance(i, p, h) == 0 ? lifting.node(i, h) : LiftingTable::None;
+                        if (node == LiftingTable::None) {
+                                if (!stretch(obstacles, i, p, h)) { return stopped_at(p, h); }
+                                continue;
+                        }
+
+                        // Start one level above the last jump taken, so a long jump is found without probing every
+                        // level's (possibly large) bounding box each time.
+                        auto taken = false;
+                        for (k = std::min(k + 1, lifting.levels() - 1);; --k) {
+                                const auto& jump = lifting.jump(k, node);
+                                if (jump.cells != 0 && !visited_in(jump)) {
+                                        taken = true;
+                                        break;
+                                }
+                                if (k == 0) { break; }
+                        }
+                        if (!taken) {
+                                if (!stretch(obstacles, i, p, h)) { return stopped_at(p, h); }
+                                continue;
+                        }
+
+                        for (size_t e = 0; e < size_t{1} << k; ++e) {
+                                const auto& edge = lifting.jump(0, node);
+                                h = lifting.leave(node);
+                                enter(i, p, h, edge.cells);
+                                node = edge.next;
+                        }
+                        just_visited = false;
+                        nblocked = 0;
+                }
+        }
+
+        /**
+         * @brief Stretches entered by run(const Obstacles&), starting with the start cell. Empty unless tracing.
+         */
+        [[nodiscard]] auto trace_segments() const -> const Segments&
+        { return segments; }
+
+        /**
+         * @brief Poses entered so far, in order. Empty unless the robot was built with tracing on.
+         */
+        [[nodiscard]] auto trace() const -> const Poses&
+        { return poses; }
+
+        /**
+         * @brief Prints the traced path; prints an empty map unless tracing is on.
+         */
+        auto show() const
+        {
+                const auto[w, h] = geometry.shape();
+
+                Map::Layout m(static_cast<Map::Layout::size_type>(h),
+                              std::string(static_cast<Map::Layout::size_type>(w), '\0'));
+
+                for (const auto& pose: poses) {
+                        const auto[x, y] = pose.p;
+                        m[y][x] = "rdlu"[static_cast<size_t>(to_heading(pose.d))];
+                }
+
+                Map::show(m);
+        }
+
+    private:
+        static auto blocked_cell() -> Cell
+        {
+                if constexpr (Tabled) { return CellState::Blocked; }
+                else { return Blocked{}; }
+        }
+
+        /**
+         * @brief Stops the robot for good, recording why.
+         */
+        auto stop() -> Termination
+        {
+                halted = true;
+                return ended = nblocked == static_cast<int>(DirectionCount) ? Termination::Stuck : Termination::RevisitStop;
+        }
+
+        /**
+         * @brief Ends one of the table-driven runs: leaves the robot at (p, h) and stops it.
+         * @return no. of cells cleaned.
+         */
+        auto stopped_at(const Position p, const Heading h) -> size_t
+        {
+                current = pose_cast<Repr>(BasicPose<TableRepr>{p, h});
+                stop();
+                return ncleaned;
+        }
+
+        /**
+         * @brief Takes the rotations at plane index i (coordinate p) and then either one move onto a visited cell or the
+         * whole stretch of empty cells ahead.
+         * @return false if the robot stops.
+         */
+        template <class Obstacles>
+        auto stretch(const Obstacles& obstacles, size_t& i, Position& p, Heading& h) -> bool
+        {
+                size_t ahead;
+                for (; (ahead = obstacles.distance(i, p, h)) == 0;) { // nblocked counts on from a paused rotation
+                        if (++nblocked == DirectionCount) { return false; }
+                        h = rotated(h);
+                }
+                nblocked = 0;
+
+                const auto d = delta(h);
+                const auto n = coverage.unvisited_run(i, d, ahead);
+                if (n == 0) { // the cell ahead is visited
+                        if (just_visited) { return false; }
+                        just_visited = true;
+                        i = static_cast<size_t>(static_cast<ptrdiff_t>(i) + d);
+                        p = p + h;
+                        return true;
+                }
+                enter(i, p, h, n);
+                just_visited = false;
+                return true;
+        }
+
+        /**
+         * @brief Enters the n empty cells ahead in heading h, marking and tracing them, and moves i and p to the last.
+         */
+        auto enter(size_t& i, Position& p, const Heading h, const size_t n) -> void
+        {
+                const auto d = delta(h);
+                coverage.mark_span(static_cast<size_t>(static_cast<ptrdiff_t>(i) + d), d, n, p + h, h);
+                if (tracing) { segments.push_back(Segment{p + h, h, static_cast<std::uint32_t>(n)}); }
+                ncleaned += n;
+                i = static_cast<size_t>(static_cast<ptrdiff_t>(i) + d * static_cast<ptrdiff_t>(n));
+                p = moved(p, h, static_cast<int>(n));
+        }
+
+        [[nodiscard]] auto delta(const Heading h) const -> ptrdiff_t
+        {
+                const ptrdiff_t stride = geometry.row_stride();
+                const ptrdiff_t deltas[DirectionCount] = {1, stride, -1, -stride};
+                return deltas[static_cast<size_t>(h)];
+        }
+
+        /**
+         * @brief Checks whether any cell in the bounding box of a lifting jump is visited.
+         */
+        [[nodiscard]] auto visited_in(const LiftingTable::Jump& jump) const -> bool
+        {
+                for (auto y = jump.y0; y <= jump.y1; ++y) {
+                        if (coverage.any(geometry.index(Position{jump.x0, y}), geometry.index(Position{jump.x1, y}))) {
+                                return true;
+                        }
+                }
+                return false;
+        }
+
+        auto enter_empty(const Pose& pose) -> State
+        {
+                if (just_visited) { just_visited = false; }
+                nblocked = 0;
+                coverage.mark(geometry.index(pose.p), pose.p);
+                ncleaned += 1;
+                if (tracing) { poses.push_back(pose); }
+                return Running{pose};
+        }
+
+        auto enter_visited(const Pose& pose) -> State
+        {
+                if (just_visited) { return Stopped{}; }
+                just_visited = true;
+                nblocked     = 0;
+                return Running{pose};
+        }
+
+        auto blocked(const Pose& p) -> State
+        {
+                const auto pose = p.rotate();
+                nblocked += 1;
+                if (nblocked == DirectionCount) { return Stopped{}; }
+                return Running{pose};
+        }
+};
+
+using Robot = BasicRobot<VariantRepr>;
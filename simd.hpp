@@ -0,0 +1,331 @@
+#pragma once
+
+#include "robot.hpp"
+
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ROBOT_CLEANER_X86 1
+#endif
+
+/**
+ * Lane-parallel robots: up to 16 robots on one geometry step in lockstep, one per SIMD lane.
+ *
+ * Robot state is kept as a structure of arrays (plane index, heading, blocked count, just-visited flag, cleaned count)
+ * and each step is computed for all lanes at once: the cell codes and visited bits ahead are gathered, the
+ * Empty/Visited/Blocked outcome of BasicRobot::move_to becomes three lane masks, and every field is updated under
+ * its mask. Visits are kept in a shared plane with one bit per lane for every cell, so each lane sees only its own
+ * robot's visits. The kernels run until some lane stops; the driver then records that lane's result, undoes its visits
+ * and gives the lane the next start pose.
+ *
+ * There are AVX2 (8 lanes) and AVX-512 (16 lanes) kernels compiled with target attributes, so the binary needs neither
+ * at build time, and a portable scalar kernel; the widest one the CPU supports is picked at run time.
+ */
+namespace lanes
+{
+        enum class Isa { Scalar, Avx2, Avx512 };
+
+        /**
+         * @brief The widest instruction set the running CPU supports.
+         */
+        inline auto detect() -> Isa
+        {
+#if defined(ROBOT_CLEANER_X86)
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512f")) { return Isa::Avx512; }
+                if (__builtin_cpu_supports("avx2")) { return Isa::Avx2; }
+#endif
+                return Isa::Scalar;
+        }
+
+        inline auto name(const Isa isa) -> const char*
+        {
+                switch (isa) {
+                        case Isa::Avx2: return "avx2";
+                        case Isa::Avx512: return "avx512";
+                        default: return "scalar";
+                }
+        }
+
+        constexpr auto MaxLanes = size_t{16};
+
+        /**
+         * @brief Lane state, structure-of-arrays. Inactive lanes hold stale values and are masked out.
+         */
+        struct State
+        {
+                alignas(64) std::int32_t i[MaxLanes];        // plane index
+                alignas(64) std::int32_t h[MaxLanes];        // Heading
+                alignas(64) std::int32_t nblocked[MaxLanes];
+                alignas(64) std::int32_t just_visited[MaxLanes];
+                alignas(64) std::int32_t ncleaned[MaxLanes];
+                std::uint32_t            active; // bit l set if lane l holds a running robot
+        };
+
+        /**
+         * @brief Cells each lane has marked, so a stopped lane's visits can be undone.
+         */
+        using Marks = std::vector<std::int32_t>[MaxLanes];
+
+        /**
+         * @brief What a kernel needs of the map: the 2-bit plane, the per-lane visited plane and the index deltas of the
+         * four headings.
+         */
+        struct Planes
+        {
+                const MapGeometry::Word* cells;
+                std::uint16_t*           visited;
+                std::int32_t             delta[8]; // R, D, L, U, repeated so a lane can index it with h
+        };
+
+        /**
+         * @brief Portable kernel over Lanes lanes: steps every active lane until at least one stops.
+         * @return mask of the lanes that stopped; they are cleared from state.active.
+         */
+        template <size_t Lanes>
+        auto step_scalar(const Planes& planes, State& state, Marks& marks) -> std::uint32_t
+        {
+                while (state.active) {
+                        std::uint32_t stopped = 0;
+                        for (size_t l = 0; l < Lanes; ++l) {
+                                if (!(state.active >> l & 1u)) { continue; }
+                                const auto next  = state.i[l] + planes.delta[state.h[l]];
+                                const auto n     = static_cast<size_t>(next);
+                                const auto bit   = static_cast<std::uint16_t>(1u << l);
+                                const auto code  = (planes.cells[n / MapGeometry::CellsPerWord] >> (n % MapGeometry::CellsPerWord * 2)) & 3u;
+                                if (planes.visited[n] & bit) {
+                                        if (state.just_visited[l]) { stopped |= 1u << l; }
+                                        state.just_visited[l] = 1;
+                                        state.nblocked[l] = 0;
+                                        state.i[l] = next;
+                                }
+                                else if (code == static_cast<MapGeometry::Word>(CellState::Blocked)) {
+                                        state.h[l] = (state.h[l] + 1) & 3;
+                                        if (++state.nblocked[l] == static_cast<std::int32_t>(DirectionCount)) { stopped |= 1u << l; }
+                                }
+                                else {
+                                        planes.visited[n] |= bit;
+                                        marks[l].push_back(next);
+                                        state.just_visited[l] = 0;
+                                        state.nblocked[l] = 0;
+                                        state.ncleaned[l] += 1;
+                                        state.i[l] = next;
+                                }
+                        }
+                        if (stopped) {
+                                state.active &= ~stopped;
+                                return stopped;
+                        }
+                }
+                return 0;
+        }
+
+#if defined(ROBOT_CLEANER_X86)
+        /**
+         * @brief AVX2 kernel, 8 lanes. Same contract as step_scalar.
+         */
+        __attribute__((target("avx2"))) inline auto step_avx2(const Planes& planes, State& state, Marks& marks)
+                -> std::uint32_t
+        {
+                const auto lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+                const auto three     = _mm256_set1_epi32(3);
+                const auto one       = _mm256_set1_epi32(1);
+                const auto four      = _mm256_set1_epi32(static_cast<int>(DirectionCount));
+                const auto blocked   = _mm256_set1_epi32(static_cast<int>(CellState::Blocked));
+                const auto deltas    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes.delta));
+                const auto* cells    = reinterpret_cast<const int*>(planes.cells);
+                const auto* visited  = reinterpret_cast<const int*>(planes.visited);
+
+                auto i  = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.i));
+                auto h  = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.h));
+                auto nb = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.nblocked));
+                auto jv = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.just_visited));
+                auto nc = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.ncleaned));
+                auto active = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(state.active)), lane_bits), lane_bits);
+
+                std::uint32_t stopped = 0;
+                while (!stopped && state.active) {
+                        const auto next = _mm256_add_epi32(i, _mm256_permutevar8x32_epi32(deltas, h));
+
+                        // 2-bit code: 16 cells per 32-bit word of the plane.
+                        const auto word  = _mm256_i32gather_epi32(cells, _mm256_srli_epi32(next, 4), 4);
+                        const auto shift = _mm256_slli_epi32(_mm256_and_si256(next, _mm256_set1_epi32(15)), 1);
+                        const auto code  = _mm256_and_si256(_mm256_srlv_epi32(word, shift), three);
+                        // Lane bits: 16 bits per cell, read as the low half of a 32-bit load.
+                        const auto seen  = _mm256_i32gather_epi32(visited, next, 2);
+
+                        const auto is_visited = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(seen, lane_bits), _mm256_setzero_si256()), active);
+                        const auto is_blocked = _mm256_andnot_si256(is_visited, _mm256_and_si256(_mm256_cmpeq_epi32(code, blocked), active));
+                        const auto is_empty   = _mm256_andnot_si256(_mm256_or_si256(is_visited, is_blocked), active);
+                        const auto moves      = _mm256_or_si256(is_visited, is_empty);
+
+                        const auto nb_next = _mm256_add_epi32(nb, one);
+                        const auto stop = _mm256_or_si256(_mm256_and_si256(is_visited, jv),
+                                                          _mm256_and_si256(is_blocked, _mm256_cmpeq_epi32(nb_next, four)));
+
+                        i  = _mm256_blendv_epi8(i, next, moves);
+                        h  = _mm256_blendv_epi8(h, _mm256_and_si256(_mm256_add_epi32(h, one), three), is_blocked);
+                        nb = _mm256_blendv_epi8(_mm256_blendv_epi8(nb, nb_next, is_blocked), _mm256_setzero_si256(), moves);
+                        jv = _mm256_blendv_epi8(_mm256_blendv_epi8(jv, _mm256_setzero_si256(), is_empty), _mm256_set1_epi32(-1), is_visited);
+                        nc = _mm256_sub_epi32(nc, is_empty);
+
+                        if (auto empty = static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(is_empty)))) {
+                                alignas(32) std::int32_t cells_entered[8];
+                                _mm256_store_si256(reinterpret_cast<__m256i*>(cells_entered), next);
+                                for (; empty; empty &= empty - 1) {
+                                        const auto l = static_cast<size_t>(__builtin_ctz(empty));
+                                        planes.visited[cells_entered[l]] |= static_cast<std::uint16_t>(1u << l);
+                                        marks[l].push_back(cells_entered[l]);
+                                }
+                        }
+                        stopped = static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(stop)));
+                        active  = _mm256_andnot_si256(stop, active);
+                }
+
+                _mm256_store_si256(reinterpret_cast<__m256i*>(state.i), i);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(state.h), h);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(state.nblocked), nb);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(state.just_visited), jv);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(state.ncleaned), nc);
+                state.active &= ~stopped;
+                return stopped;
+        }
+
+        /**
+         * @brief AVX-512 kernel, 16 lanes, with mask registers for the outcomes. Same contract as step_scalar.
+         */
+        __attribute__((target("avx512f"))) inline auto step_avx512(const Planes& planes, State& state, Marks& marks)
+                -> std::uint32_t
+        {
+                const auto lane_bits = _mm512_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768);
+                const auto three     = _mm512_set1_epi32(3);
+                const auto one       = _mm512_set1_epi32(1);
+                const auto four      = _mm512_set1_epi32(static_cast<int>(DirectionCount));
+                const auto blocked   = _mm512_set1_epi32(static_cast<int>(CellState::Blocked));
+                const auto deltas    = _mm512_castsi256_si512(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes.delta)));
+                const auto* cells    = reinterpret_cast<const int*>(planes.cells);
+                const auto* visited  = reinterpret_cast<const int*>(planes.visited);
+
+                auto i  = _mm512_load_si512(state.i);
+                auto h  = _mm512_load_si512(state.h);
+                auto nb = _mm512_load_si512(state.nblocked);
+                auto jv = static_cast<__mmask16>(_mm512_cmpneq_epi32_mask(_mm512_load_si512(state.just_visited), _mm512_setzero_si512()));
+                auto nc = _mm512_load_si512(state.ncleaned);
+                auto active = static_cast<__mmask16>(state.active);
+
+                __mmask16 stopped = 0;
+                // The all-lanes maskz forms compile to the plain instructions; the unmasked intrinsics pass an undefined
+                // vector that GCC 12 reports as maybe-uninitialized.
+                const auto all = static_cast<__mmask16>(0xFFFF);
+                while (!stopped && active) {
+                        const auto next = _mm512_add_epi32(i, _mm512_maskz_permutexvar_epi32(all, h, deltas));
+
+                        const auto word  = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), active, _mm512_maskz_srli_epi32(all, next, 4), cells, 4);
+                        const auto shift = _mm512_maskz_slli_epi32(all, _mm512_and_si512(next, _mm512_set1_epi32(15)), 1);
+                        const auto code  = _mm512_and_si512(_mm512_maskz_srlv_epi32(all, word, shift), three);
+                        const auto seen  = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), active, next, visited, 2);
+
+                        const auto is_visited = static_cast<__mmask16>(_mm512_mask_test_epi32_mask(active, seen, lane_bits));
+                        const auto is_blocked = static_cast<__mmask16>(_mm512_mask_cmpeq_epi32_mask(active & ~is_visited, code, blocked));
+                        const auto is_empty   = static_cast<__mmask16>(active & ~is_visited & ~is_blocked);
+                        const auto moves      = static_cast<__mmask16>(is_visited | is_empty);
+
+                        const auto nb_next = _mm512_add_epi32(nb, one);
+                        const auto stop = static_cast<__mmask16>((is_visited & jv) | _mm512_mask_cmpeq_epi32_mask(is_blocked, nb_next, four));
+
+                        i  = _mm512_mask_mov_epi32(i, moves, next);
+                        h  = _mm512_mask_and_epi32(h, is_blocked, _mm512_add_epi32(h, one), three);
+                        nb = _mm512_mask_mov_epi32(_mm512_mask_mov_epi32(nb, is_blocked, nb_next), moves, _mm512_setzero_si512());
+                        jv = static_cast<__mmask16>((jv & ~is_empty) | is_visited);
+                        nc = _mm512_mask_add_epi32(nc, is_empty, nc, one);
+
+                        if (std::uint32_t empty = is_empty) {
+                                alignas(64) std::int32_t cells_entered[16];
+                                _mm512_store_si512(cells_entered, next);
+                                for (; empty; empty &= empty - 1) {
+                                        const auto l = static_cast<size_t>(__builtin_ctz(empty));
+                                        planes.visited[cells_entered[l]] |= static_cast<std::uint16_t>(1u << l);
+                                        marks[l].push_back(cells_entered[l]);
+                                }
+                        }
+                        stopped = stop;
+                        active  = static_cast<__mmask16>(active & ~stop);
+                }
+
+                _mm512_store_si512(state.i, i);
+                _mm512_store_si512(state.h, h);
+                _mm512_store_si512(state.nblocked, nb);
+                _mm512_store_si512(state.just_visited, _mm512_maskz_mov_epi32(jv, _mm512_set1_epi32(-1)));
+                _mm512_store_si512(state.ncleaned, nc);
+                state.active = active;
+                return stopped;
+        }
+#endif
+
+        /**
+         * @brief No. of lanes the kernel for an instruction set runs.
+         */
+        constexpr auto width(const Isa isa) -> size_t
+        { return isa == Isa::Avx512 ? 16 : 8; }
+}
+
+/**
+ * @brief Runs BasicRobot::run from every start pose on one geometry, 8 or 16 robots at a time in SIMD lanes.
+ * @param isa Kernel to use; the widest the CPU supports by default.
+ * @return no. of cells cleaned from each start pose, in order.
+ */
+inline auto run_lanes(const MapGeometry& geometry, const std::vector<Pose>& starts, const lanes::Isa isa = lanes::detect())
+        -> std::vector<size_t>
+{
+        using namespace lanes;
+
+        // Plane indices are signed 32-bit lanes, which must not wrap.
+        if (geometry.size() >= (size_t{1} << 31)) { throw std::length_error{"map is too large for 32-bit lane indices"}; }
+
+        // One spare cell so a 32-bit gather of the last cell's 16 lane bits stays in bounds.
+        std::vector<std::uint16_t> visited(geometry.size() + 1);
+        const auto stride = geometry.row_stride();
+        const Planes planes{geometry.data(), visited.data(), {1, stride, -1, -stride, 1, stride, -1, -stride}};
+
+        const auto nlanes = width(isa);
+        State state{};
+        Marks marks;
+        std::vector<size_t> cleaned(starts.size());
+        std::vector<size_t> job(nlanes);
+        size_t next_job = 0;
+
+        const auto start = [&](const size_t l) {
+                const auto pose = pose_cast<TableRepr>(starts[next_job]);
+                const auto i    = static_cast<std::int32_t>(geometry.index(pose.p));
+                job[l]                = next_job++;
+                state.i[l]            = i;
+                state.h[l]            = static_cast<std::int32_t>(pose.d);
+                state.nblocked[l]     = 0;
+                state.just_visited[l] = 0;
+                state.ncleaned[l]     = 1;
+                state.active |= 1u << l;
+                visited[static_cast<size_t>(i)] |= static_cast<std::uint16_t>(1u << l);
+                marks[l].push_back(i);
+        };
+        for (size_t l = 0; l < nlanes && next_job < starts.size(); ++l) { start(l); }
+
+        while (state.active) {
+                std::uint32_t stopped;
+                switch (isa) {
+#if defined(ROBOT_CLEANER_X86)
+                        case Isa::Avx512: stopped = step_avx512(planes, state, marks); break;
+                        case Isa::Avx2: stopped = step_avx2(planes, state, marks); break;
+#endif
+                        default: stopped = step_scalar<8>(planes, state, marks);
+                }
+                for (; stopped; stopped &= stopped - 1) {
+                        const auto l = static_cast<size_t>(__builtin_ctz(stopped));
+                        cleaned[job[l]] = static_cast<size_t>(state.ncleaned[l]);
+                        for (const auto i: marks[l]) { visited[static_cast<size_t>(i)] &= static_cast<std::uint16_t>(~(1u << l)); }
+                        marks[l].clear();
+                        if (next_job < starts.size()) { start(l); }
+                }
+        }
+        return cleaned;
+}
@@ -0,0 +1,23 @@
+#include "map_file.hpp"
+#include "sweep.hpp"
+
+/**
+ * @brief Writes the cleaned count of every start pose of a map (text, or binary if it ends in .rcm) to a sweep file.
+ */
+auto main(int argc, char** argv) -> int
+{
+        if (argc != 3) {
+                std::fprintf(stderr, "usage: %s <map.txt|map.rcm> <sweep.rcs>\n", argv[0]);
+                return 2;
+        }
+        try {
+                const std::string path = argv[1];
+                const auto binary = path.size() > 4 && path.compare(path.size() - 4, 4, ".rcm") == 0;
+                const auto geometry = binary ? open_map(path, MapCheck::Cells) : parse_text_map(path);
+                save_sweep(sweep_all(*geometry), argv[2]);
+        }
+        catch (const std::exception& e) {
+                std::fprintf(stderr, "%s\n", e.what());
+                return 1;
+        }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "robot.hpp"
+#include "parallel.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <system_error>
+
+/**
+ * @brief Cleaned counts for every start pose of a map: entry (y * w + x) * 4 + h is the count of a robot starting at
+ * (x, y) with heading h, and 0 for a blocked cell.
+ */
+class SweepGrid
+{
+        int                        w, h;
+        std::vector<std::uint32_t> counts;
+
+    public:
+        SweepGrid(const int w, const int h) : w{w}, h{h}, counts(static_cast<size_t>(w) * static_cast<size_t>(h) * DirectionCount) {}
+
+        [[nodiscard]] auto at(const Position p, const Heading d) const -> std::uint32_t
+        { return counts[offset(p, d)]; }
+
+        auto at(const Position p, const Heading d) -> std::uint32_t&
+        { return counts[offset(p, d)]; }
+
+        [[nodiscard]] auto shape() const -> std::pair<int, int>
+        { return {w, h}; }
+
+        [[nodiscard]] auto data() const -> const std::uint32_t*
+        { return counts.data(); }
+
+        [[nodiscard]] auto size() const -> size_t
+        { return counts.size(); }
+
+    private:
+        [[nodiscard]] auto offset(const Position p, const Heading d) const -> size_t
+        { return (static_cast<size_t>(p.y) * static_cast<size_t>(w) + static_cast<size_t>(p.x)) * DirectionCount + static_cast<size_t>(d); }
+};
+
+/**
+ * @brief Runs Robot::run from every free cell with every heading, in parallel.
+ *
+ * The static work is done once: the robots all use the given DistanceTable, so each straight stretch is one lookup.
+ * Each worker thread keeps one CoverageState and one trace arena for all of its runs. A run traces its segments and
+ * afterwards clears exactly those cells again, so resetting costs the cells it cleaned rather than the size of the
+ * map. The arena allocates from a buffer it keeps across runs, and the buffer is regrown whenever a trace outgrows it,
+ * so once the longest traces have been seen the runs no longer allocate. Work is handed out by rows.
+ */
+inline auto sweep_all(const MapGeometry& geometry, const DistanceTable& distances, const unsigned nthreads = default_threads())
+        -> SweepGrid
+{
+        struct Scratch
+        {
+                CoverageState                                      coverage;
+                std::vector<std::byte>                             buffer;
+                std::optional<std::pmr::monotonic_buffer_resource> arena; // over buffer
+
+                explicit Scratch(const MapGeometry& geometry) : coverage{geometry}, buffer(size_t{1} << 16)
+                { arena.emplace(buffer.data(), buffer.size()); }
+        };
+
+        const auto[w, h] = geometry.shape();
+        SweepGrid grid{w, h};
+
+        const auto workers = static_cast<unsigned>(std::clamp<size_t>(nthreads, 1, std::max<size_t>(static_cast<size_t>(h), 1)));
+        std::vector<std::unique_ptr<Scratch>> scratch(workers);
+        for (auto& s: scratch) { s = std::make_unique<Scratch>(geometry); }
+
+        const ptrdiff_t stride = geometry.row_stride();
+        const ptrdiff_t delta[DirectionCount] = {1, stride, -1, -stride};
+
+        parallel_for(static_cast<size_t>(h), [&](const size_t y, const unsigned t) {
+                auto& [coverage, buffer, arena] = *scratch[t];
+                for (int x = 0; x < w; ++x) {
+                        const Position p{x, static_cast<int>(y)};
+                        if (geometry.state(p) == CellState::Blocked) { continue; }
+                        for (size_t d = 0; d < DirectionCount; ++d) {
+                                size_t used;
+                                {
+                                        BasicRobot<TableRepr> robot{geometry, coverage, {p, static_cast<Heading>(d)}, true, &*arena};
+                                        grid.at(p, static_cast<Heading>(d)) = static_cast<std::uint32_t>(robot.run(distances));
+                                        for (const auto& segment: robot.trace_segments()) {
+                                                coverage.unmark_span(geometry.index(segment.from), delta[static_cast<size_t>(segment.heading)],
+                                                                     segment.length);
+                                        }
+                                        // The trace grew geometrically, so all of its buffers together are under twice
+                                        // the last one.
+                                        used = 2 * robot.trace_segments().capacity() * sizeof(Segment);
+                                }
+                                arena->release();
+                                if (used > buffer.size()) {
+                                        arena.reset();
+                                        buffer.resize(2 * used);
+                                        arena.emplace(buffer.data(), buffer.size());
+                                }
+                        }
+                }
+        }, workers);
+        return grid;
+}
+
+/**
+ * @brief Same, building the distance table first.
+ */
+inline auto sweep_all(const MapGeometry& geometry, const unsigned nthreads = default_threads()) -> SweepGrid
+{ return sweep_all(geometry, DistanceTable{geometry, nthreads}, nthreads); }
+
+/**
+ * @brief Header of the binary sweep format: the header is followed by the w x h x 4 counts of a SweepGrid as 32-bit
+ * values in host byte order.
+ */
+struct SweepFileHeader
+{
+        static constexpr char Magic[8] = {'R', 'C', 'S', 'W', 'E', 'E', 'P', '1'};
+
+        char          magic[8];
+        std::uint32_t w, h;
+        std::uint8_t  reserved[48]; // pads the header to 64 bytes
+};
+
+static_assert(sizeof(SweepFileHeader) == 64);
+
+/**
+ * @brief Writes the counts to a binary sweep file.
+ */
+inline auto save_sweep(const SweepGrid& grid, const std::string& path) -> void
+{
+        const auto[w, h] = grid.shape();
+
+        SweepFileHeader header{};
+        std::memcpy(header.magic, SweepFileHeader::Magic, sizeof header.magic);
+        header.w = static_cast<std::uint32_t>(w);
+        header.h = static_cast<std::uint32_t>(h);
+
+        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(&header), sizeof header);
+        out.write(reinterpret_cast<const char*>(grid.data()), static_cast<std::streamsize>(grid.size() * sizeof(std::uint32_t)));
+        if (!out) { throw std::system_error{errno, std::generic_category(), "cannot write " + path}; }
+}
@@ -0,0 +1,33 @@
+#include "map_file.hpp"
+#include "whatif.hpp"
+
+#include <cstdlib>
+
+/**
+ * @brief Finds the obstacles whose removal would most improve a run from the origin heading right: prints the top k
+ * and writes the cleaned count for every blocked cell to a what-if file.
+ */
+auto main(int argc, char** argv) -> int
+{
+        if (argc != 3 && argc != 4) {
+                std::fprintf(stderr, "usage: %s <map.txt|map.rcm> <heatmap.rcw> [k]\n", argv[0]);
+                return 2;
+        }
+        try {
+                const std::string path = argv[1];
+                const auto binary = path.size() > 4 && path.compare(path.size() - 4, 4, ".rcm") == 0;
+                const auto geometry = binary ? open_map(path, MapCheck::Cells) : parse_text_map(path);
+                const auto k = argc == 4 ? std::strtoul(argv[3], nullptr, 10) : 10ul;
+
+                const auto result = what_if(*geometry, {Position{0, 0}, Heading::R});
+                save_what_if(result, argv[2]);
+                std::printf("cleaned: %zu\n", result.cleaned());
+                for (const auto& [p, cleaned]: result.top(k)) {
+                        std::printf("(%d, %d): %zu (%+td)\n", p.x, p.y, cleaned, result.gain(p));
+                }
+        }
+        catch (const std::exception& e) {
+                std::fprintf(stderr, "%s\n", e.what());
+                return 1;
+        }
+}
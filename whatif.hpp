@@ -0,0 +1,149 @@
+#pragma once
+
+#include "incremental.hpp"
+#include "parallel.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <system_error>
+
+/**
+ * @brief For every blocked cell of a map, the no. of cells a run cleans with that cell freed.
+ */
+class WhatIf
+{
+        int                        w, h;
+        size_t                     base;    // cleaned on the unedited map
+        std::vector<std::uint32_t> counts;  // [y * w + x], 0 for free cells
+
+    public:
+        struct Entry
+        {
+                Position p;
+                size_t   cleaned;
+        };
+
+        WhatIf(const int w, const int h, const size_t base)
+            : w{w}, h{h}, base{base}, counts(static_cast<size_t>(w) * static_cast<size_t>(h)) {}
+
+        [[nodiscard]] auto at(const Position p) const -> std::uint32_t
+        { return counts[offset(p)]; }
+
+        auto at(const Position p) -> std::uint32_t&
+        { return counts[offset(p)]; }
+
+        /**
+         * @brief Change in the cleaned count from freeing a blocked cell; 0 for a free cell.
+         */
+        [[nodiscard]] auto gain(const Position p) const -> ptrdiff_t
+        { return at(p) == 0 ? 0 : static_cast<ptrdiff_t>(at(p)) - static_cast<ptrdiff_t>(base); }
+
+        /**
+         * @brief The k blocked cells whose removal cleans the most, best first; ties go to the earlier cell in row order.
+         */
+        [[nodiscard]] auto top(const size_t k) const -> std::vector<Entry>
+        {
+                std::vector<Entry> entries;
+                for (int y = 0; y < h; ++y) {
+                        for (int x = 0; x < w; ++x) {
+                                if (const auto n = at(Position{x, y})) { entries.push_back(Entry{Position{x, y}, n}); }
+                        }
+                }
+                const auto n = std::min(k, entries.size());
+                std::partial_sort(entries.begin(), entries.begin() + static_cast<ptrdiff_t>(n), entries.end(),
+                                  [](const Entry& lhs, const Entry& rhs) {
+                                          if (lhs.cleaned != rhs.cleaned) { return lhs.cleaned > rhs.cleaned; }
+                                          return std::pair{lhs.p.y, lhs.p.x} < std::pair{rhs.p.y, rhs.p.x};
+                                  });
+                entries.resize(n);
+                return entries;
+        }
+
+        [[nodiscard]] auto cleaned() const -> size_t
+        { return base; }
+
+        [[nodiscard]] auto shape() const -> std::pair<int, int>
+        { return {w, h}; }
+
+        [[nodiscard]] auto data() const -> const std::uint32_t*
+        { return counts.data(); }
+
+        [[nodiscard]] auto size() const -> size_t
+        { return counts.size(); }
+
+    private:
+        [[nodiscard]] auto offset(const Position p) const -> size_t
+        { return static_cast<size_t>(p.y) * static_cast<size_t>(w) + static_cast<size_t>(p.x); }
+};
+
+/**
+ * @brief Runs Robot::run from the start pose once with each blocked cell of the map freed, in parallel.
+ *
+ * A blocked cell the unedited run never peeks at cannot change it and gets the base count without any work. For the
+ * others each worker keeps its own copy of the unedited IncrementalRun and frees the cell, which re-simulates only from
+ * the checkpoint before the run first looked at it, then blocks it again, which re-simulates the same tail back.
+ */
+inline auto what_if(const MapGeometry& geometry, const BasicPose<TableRepr> start, const unsigned nthreads = default_threads())
+        -> WhatIf
+{
+        const IncrementalRun base{geometry, start};
+        const auto[w, h] = geometry.shape();
+        WhatIf result{w, h, base.cleaned()};
+
+        std::vector<Position> candidates;
+        for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) {
+                        const Position p{x, y};
+                        if (geometry.state(p) != CellState::Blocked) { continue; }
+                        if (base.peeked_at(p) == IncrementalRun::None) { result.at(p) = static_cast<std::uint32_t>(base.cleaned()); }
+                        else { candidates.push_back(p); }
+                }
+        }
+
+        const auto workers = static_cast<unsigned>(std::clamp<size_t>(nthreads, 1, std::max<size_t>(candidates.size(), 1)));
+        std::vector<std::optional<IncrementalRun>> runs(workers);
+        parallel_for(candidates.size(), [&](const size_t k, const unsigned t) {
+                auto& run = runs[t];
+                if (!run) { run.emplace(base); }
+                result.at(candidates[k]) = static_cast<std::uint32_t>(run->toggle(candidates[k]));
+                run->toggle(candidates[k]);
+        }, workers);
+        return result;
+}
+
+/**
+ * @brief Header of the binary what-if format: the header is followed by the w x h counts of a WhatIf as 32-bit values
+ * in host byte order, 0 for free cells.
+ */
+struct WhatIfFileHeader
+{
+        static constexpr char Magic[8] = {'R', 'C', 'W', 'H', 'A', 'T', 'I', 'F'};
+
+        char          magic[8];
+        std::uint32_t w, h;
+        std::uint64_t cleaned;      // count on the unedited map
+        std::uint8_t  reserved[40]; // pads the header to 64 bytes
+};
+
+static_assert(sizeof(WhatIfFileHeader) == 64);
+
+/**
+ * @brief Writes the counts to a binary what-if file, a heatmap over the map.
+ */
+inline auto save_what_if(const WhatIf& result, const std::string& path) -> void
+{
+        const auto[w, h] = result.shape();
+
+        WhatIfFileHeader header{};
+        std::memcpy(header.magic, WhatIfFileHeader::Magic, sizeof header.magic);
+        header.w       = static_cast<std::uint32_t>(w);
+        header.h       = static_cast<std::uint32_t>(h);
+        header.cleaned = result.cleaned();
+
+        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(&header), sizeof header);
+        out.write(reinterpret_cast<const char*>(result.data()), static_cast<std::streamsize>(result.size() * sizeof(std::uint32_t)));
+        if (!out) { throw std::system_error{errno, std::generic_category(), "cannot write " + path}; }
+}